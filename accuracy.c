@@ -0,0 +1,115 @@
+#include "accuracy.h"
+#include "mixed_precision.h"
+#include "comm.h"
+#include <math.h>
+
+// Number of recursion levels before the leaves, and the leaf size
+static int strassenLevels(int n, int cutoff, int* n0) {
+    int levels = 0;
+    *n0 = n;
+    while (*n0 > cutoff && *n0 > 1) {
+        *n0 /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+
+double strassenErrorCoefficient(int n, int cutoff) {
+    int n0;
+    int levels = strassenLevels(n, cutoff, &n0);
+    return pow(12.0, levels) * ((double)n0 * n0 + 5.0 * n0) - 5.0 * n;
+}
+
+
+double strassenErrorBound(int n, int cutoff, double max_a, double max_b) {
+#if ELEM_IS_FLOAT
+    double bound = strassenErrorCoefficient(n, cutoff) * ELEM_EPSILON;
+    int n0;
+    int levels = strassenLevels(n, cutoff, &n0);
+    if (leaf_precision == LEAF_BF16) {
+        // Rounding both leaf operands to bf16 costs 2 u_bf16 per product and
+        // the fp32 accumulation n0 u_fp32; the combination steps amplify this
+        // leaf error like the n0^2 term
+        bound += pow(12.0, levels) * n0 * (2.0 * BF16_EPSILON + n0 * 5.9604644775390625e-08);
+    }
+    if (payload_codec == PAYLOAD_BF16) {
+        // Operands rounded on the wire at some level: the subproduct of size
+        // k they feed is off by at most k * 2 u_bf16, no more than the same
+        // rounding at every leaf below it would cost
+        bound += pow(12.0, levels) * n0 * 2.0 * BF16_EPSILON;
+    }
+    return bound * max_a * max_b;
+#else
+    // Integer arithmetic is exact as long as nothing overflows
+    (void)n; (void)cutoff; (void)max_a; (void)max_b;
+    return 0.0;
+#endif
+}
+
+
+int cutoffForTolerance(int n, double tolerance) {
+    int cutoff = n;
+    while (cutoff > 1 && strassenErrorBound(n, cutoff / 2, 1.0, 1.0) <= tolerance) {
+        cutoff /= 2;
+    }
+    return cutoff;
+}
+
+
+// Exponent e with max|x| * 2^-e in [0.5, 1), or 0 for all zeros
+static int scaleExponent(double max) {
+    int e = 0;
+    if (max > 0) {
+        frexp(max, &e);
+    }
+    return e;
+}
+
+
+DiagonalScaling* scaleOperands(elem_t** A, elem_t** B, int n) {
+    DiagonalScaling* scaling = (DiagonalScaling*)malloc(sizeof(DiagonalScaling));
+    scaling->n = n;
+    scaling->row_exp = (int*)malloc(n * sizeof(int));
+    scaling->col_exp = (int*)malloc(n * sizeof(int));
+
+    for (int i = 0; i < n; i++) {
+        double max = 0;
+        for (int j = 0; j < n; j++) {
+            max = fmax(max, fabs((double)A[i][j]));
+        }
+        scaling->row_exp[i] = scaleExponent(max);
+        for (int j = 0; j < n; j++) {
+            A[i][j] = (elem_t)ldexp((double)A[i][j], -scaling->row_exp[i]);
+        }
+    }
+
+    for (int j = 0; j < n; j++) {
+        double max = 0;
+        for (int i = 0; i < n; i++) {
+            max = fmax(max, fabs((double)B[i][j]));
+        }
+        scaling->col_exp[j] = scaleExponent(max);
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            B[i][j] = (elem_t)ldexp((double)B[i][j], -scaling->col_exp[j]);
+        }
+    }
+    return scaling;
+}
+
+
+void unscaleResult(DiagonalScaling* scaling, elem_t** A, elem_t** B, elem_t** C) {
+    int n = scaling->n;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            A[i][j] = (elem_t)ldexp((double)A[i][j], scaling->row_exp[i]);
+            B[i][j] = (elem_t)ldexp((double)B[i][j], scaling->col_exp[j]);
+            C[i][j] = (elem_t)ldexp((double)C[i][j], scaling->row_exp[i] + scaling->col_exp[j]);
+        }
+    }
+    free(scaling->row_exp);
+    free(scaling->col_exp);
+    free(scaling);
+}
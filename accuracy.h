@@ -0,0 +1,40 @@
+#ifndef ACCURACY_H
+#define ACCURACY_H
+
+#include "matrix_utils.h"
+
+// Rounding error of floating-point Strassen. With L levels of recursion down
+// to leaves of size n0 = n / 2^L, Higham (Accuracy and Stability of Numerical
+// Algorithms, Thm. 23.3) bounds the computed product by
+//   max|C - AB| <= [(n/n0)^log2(12) * (n0^2 + 5*n0) - 5n] * u * max|A| * max|B|
+// to first order in the unit roundoff u. The factor grows by about 12/4 = 3x per
+// level, so the error tolerance caps how deep the recursion may go.
+
+// The bracketed factor above; L = 0 gives the classical n^2
+double strassenErrorCoefficient(int n, int cutoff);
+
+// Absolute bound on any entry of C - AB, including the bf16 leaf's input
+// rounding when that kernel is selected (see mixed_precision.h)
+double strassenErrorBound(int n, int cutoff, double max_a, double max_b);
+
+// Smallest power-of-two cutoff whose bound, relative to max|A| * max|B|, is
+// within tolerance. Returns n when even classical multiplication exceeds it.
+int cutoffForTolerance(int n, double tolerance);
+
+// Power-of-two diagonal scaling: A is replaced by Dr*A and B by B*Dc so every
+// row of A and column of B has its largest entry in [0.5, 1). Powers of two
+// are exact, and balancing the operands stops a few large rows or columns
+// from dominating the error of all the others.
+typedef struct {
+    int n;
+    int* row_exp;    // A row i was scaled by 2^-row_exp[i]
+    int* col_exp;    // B column j was scaled by 2^-col_exp[j]
+} DiagonalScaling;
+
+DiagonalScaling* scaleOperands(elem_t** A, elem_t** B, int n);
+
+// Undo the scaling: restores A and B and turns the product of the scaled
+// operands in C into AB. Frees the scaling.
+void unscaleResult(DiagonalScaling* scaling, elem_t** A, elem_t** B, elem_t** C);
+
+#endif // ACCURACY_H
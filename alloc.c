@@ -0,0 +1,246 @@
+// MAP_ANONYMOUS, MAP_HUGETLB, madvise, syscall and sched_setaffinity are
+// Linux/GNU extensions, not C99
+#define _GNU_SOURCE
+
+#include "alloc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_2M (2UL << 20)
+#define HUGE_PAGE_1G (1UL << 30)
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+#define MAX_NUMA_NODES 64
+
+// A live mapped block. Lengths are kept here rather than in a header inside
+// the mapping, so the elements start at the page boundary and a power-of-two
+// matrix fills its huge pages exactly.
+typedef struct {
+    void* base;
+    size_t length;
+} MappedBlock;
+
+int alloc_mode = ALLOC_PLAIN;
+int alloc_numa = 0;
+
+static long long num_huge = 0;
+static long long num_advised = 0;
+static pthread_mutex_t count_lock = PTHREAD_MUTEX_INITIALIZER;
+static int num_nodes = 0;
+
+static MappedBlock* mapped = NULL;
+static int num_mapped = 0;
+static int mapped_capacity = 0;
+static pthread_mutex_t mapped_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static size_t roundUp(size_t bytes, size_t unit) {
+    return (bytes + unit - 1) / unit * unit;
+}
+
+
+static void countBlock(long long* counter) {
+    pthread_mutex_lock(&count_lock);
+    (*counter)++;
+    pthread_mutex_unlock(&count_lock);
+}
+
+
+// Anonymous mapping of at least bytes, on huge pages where possible. Sets
+// *length to the size actually mapped; returns NULL on failure.
+static void* mapBlock(size_t bytes, size_t* length) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* p = MAP_FAILED;
+
+    if (alloc_mode == ALLOC_HUGE) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+        if (bytes >= HUGE_PAGE_1G) {
+            *length = roundUp(bytes, HUGE_PAGE_1G);
+            p = mmap(NULL, *length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | (30 << MAP_HUGE_SHIFT), -1, 0);
+        }
+#endif
+#ifdef MAP_HUGETLB
+        if (p == MAP_FAILED) {
+            *length = roundUp(bytes, HUGE_PAGE_2M);
+            p = mmap(NULL, *length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (p != MAP_FAILED) {
+            countBlock(&num_huge);
+            return p;
+        }
+    }
+
+    *length = roundUp(bytes, HUGE_PAGE_2M);
+    p = mmap(NULL, *length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (alloc_mode == ALLOC_HUGE && madvise(p, *length, MADV_HUGEPAGE) == 0) {
+        countBlock(&num_advised);
+    }
+#endif
+    return p;
+}
+
+
+// Prefer the calling thread's node for pages not yet touched
+static void bindToCurrentNode(void* p, size_t length) {
+#ifdef SYS_mbind
+    int node = numaCurrentNode();
+    unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 1] = { 0 };
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    syscall(SYS_mbind, p, length, MPOL_PREFERRED, mask, MAX_NUMA_NODES + 1, 0);
+#else
+    (void)p;
+    (void)length;
+#endif
+}
+
+
+static void rememberMapping(void* base, size_t length) {
+    pthread_mutex_lock(&mapped_lock);
+    if (num_mapped == mapped_capacity) {
+        mapped_capacity = mapped_capacity ? 2 * mapped_capacity : 64;
+        mapped = (MappedBlock*)realloc(mapped, mapped_capacity * sizeof(MappedBlock));
+    }
+    mapped[num_mapped].base = base;
+    mapped[num_mapped].length = length;
+    num_mapped++;
+    pthread_mutex_unlock(&mapped_lock);
+}
+
+
+// Length of the mapping at base, which is forgotten, or 0 for a heap block
+static size_t forgetMapping(void* base) {
+    size_t length = 0;
+    pthread_mutex_lock(&mapped_lock);
+    for (int i = 0; i < num_mapped; i++) {
+        if (mapped[i].base == base) {
+            length = mapped[i].length;
+            mapped[i] = mapped[--num_mapped];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mapped_lock);
+    return length;
+}
+
+
+elem_t* allocElements(size_t count, int zeroed) {
+    size_t bytes = count * sizeof(elem_t);
+    int map = (alloc_mode == ALLOC_HUGE || alloc_numa) && bytes >= ALLOC_MAP_MIN_BYTES;
+
+    if (map) {
+        size_t length = 0;
+        void* block = mapBlock(bytes, &length);
+        if (block) {
+            if (alloc_numa && numaNodeCount() > 1) {
+                bindToCurrentNode(block, length);
+            }
+            rememberMapping(block, length);
+            return (elem_t*)block;
+        }
+    }
+    // Keep a zero-element block distinct from a failed allocation
+    if (bytes == 0) {
+        bytes = sizeof(elem_t);
+    }
+    return (elem_t*)(zeroed ? calloc(1, bytes) : malloc(bytes));
+}
+
+
+void freeElements(elem_t* data, size_t count) {
+    if (!data) {
+        return;
+    }
+    // Only blocks large enough to have been mapped are looked up
+    size_t length = count * sizeof(elem_t) >= ALLOC_MAP_MIN_BYTES ? forgetMapping(data) : 0;
+    if (length) {
+        munmap(data, length);
+    } else {
+        free(data);
+    }
+}
+
+
+static FILE* openNodeCpulist(int node) {
+    char name[128];
+    snprintf(name, sizeof(name), "/sys/devices/system/node/node%d/cpulist", node);
+    return fopen(name, "r");
+}
+
+
+int numaNodeCount(void) {
+    if (num_nodes == 0) {
+        int count = 0;
+        FILE* file;
+        while (count < MAX_NUMA_NODES && (file = openNodeCpulist(count)) != NULL) {
+            fclose(file);
+            count++;
+        }
+        num_nodes = count > 0 ? count : 1;
+    }
+    return num_nodes;
+}
+
+
+int numaCurrentNode(void) {
+#ifdef SYS_getcpu
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && (int)node < MAX_NUMA_NODES) {
+        return (int)node;
+    }
+#endif
+    return 0;
+}
+
+
+int numaBindThread(int node) {
+    FILE* file = openNodeCpulist(node);
+    if (!file) {
+        return 0;
+    }
+
+    // A list of CPUs and ranges, e.g. "0-15,32-47"
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    int first, last;
+    char separator;
+    while (fscanf(file, "%d", &first) == 1) {
+        last = first;
+        if (fscanf(file, "%c", &separator) == 1 && separator == '-') {
+            if (fscanf(file, "%d", &last) != 1) {
+                break;
+            }
+            if (fscanf(file, "%c", &separator) != 1) {
+                separator = '\n';
+            }
+        }
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+        if (separator != ',') {
+            break;
+        }
+    }
+    fclose(file);
+    return CPU_COUNT(&cpus) > 0 && sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+
+void allocCounts(long long* huge, long long* advised) {
+    pthread_mutex_lock(&count_lock);
+    *huge = num_huge;
+    *advised = num_advised;
+    pthread_mutex_unlock(&count_lock);
+}
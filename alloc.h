@@ -0,0 +1,48 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include "matrix_utils.h"
+
+// Storage behind initializeMatrix and allocateMatrix. Every n x n matrix is
+// one block of elements plus an array of row pointers into it;
+// allocElements decides where the block comes from.
+//
+// - ALLOC_PLAIN (default): calloc for zeroed blocks, malloc otherwise.
+// - ALLOC_HUGE (--alloc huge): blocks of at least ALLOC_MAP_MIN_BYTES are
+//   mapped on 1 GiB pages when they span one and on 2 MiB pages otherwise
+//   (MAP_HUGETLB). If no huge pages are reserved, the mapping falls back to
+//   4 KiB pages with madvise(MADV_HUGEPAGE), so transparent huge pages can
+//   back it.
+// - With --numa, mapped blocks prefer the NUMA node of the allocating
+//   thread (mbind). The task graph (task_dag.h) then keeps one queue per
+//   node, served by threads pinned to that node, so a product's buffers are
+//   allocated and computed on the same socket.
+//
+// Everything degrades to plain allocation where the kernel lacks support.
+
+#define ALLOC_PLAIN 0
+#define ALLOC_HUGE  1
+
+// Smaller blocks are not worth a mapping of their own
+#define ALLOC_MAP_MIN_BYTES (4 << 20)
+
+extern int alloc_mode;
+extern int alloc_numa;
+
+// Storage for count elements, zeroed or left unset, and its release with the
+// same count. Fresh mappings are zero either way; unset storage skips
+// calloc's memset. Mapped blocks start at a page boundary and span a whole
+// number of pages.
+elem_t* allocElements(size_t count, int zeroed);
+void freeElements(elem_t* data, size_t count);
+
+// NUMA nodes of this machine (1 where none are reported), the node the
+// calling thread runs on, and pinning of the calling thread to a node's CPUs
+int numaNodeCount(void);
+int numaCurrentNode(void);
+int numaBindThread(int node);
+
+// Blocks mapped on huge pages, and blocks that fell back to madvise
+void allocCounts(long long* huge, long long* advised);
+
+#endif // ALLOC_H
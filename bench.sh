@@ -0,0 +1,22 @@
+#!/bin/sh
+# Sweep process counts (and optionally several builds) with the built-in
+# benchmark mode, appending every result to one CSV file.
+#
+# Usage: ./bench.sh [extra benchmark options]
+# Environment:
+#   NPS       Process counts to sweep        (default "1 2 4 8")
+#   BINARIES  Executables to compare         (default "./strassen_mpi")
+#   CSV       Output file                    (default "bench_results.csv")
+#   MPIRUN    Launcher command               (default "mpirun")
+
+NPS=${NPS:-"1 2 4 8"}
+BINARIES=${BINARIES:-"./strassen_mpi"}
+CSV=${CSV:-"bench_results.csv"}
+MPIRUN=${MPIRUN:-"mpirun"}
+
+for binary in $BINARIES; do
+    for np in $NPS; do
+        echo "== $binary with $np processes =="
+        $MPIRUN -np "$np" "$binary" --bench --csv "$CSV" "$@" || exit 1
+    done
+done
@@ -0,0 +1,253 @@
+#include "benchmark.h"
+#include "random_matrix.h"
+#include "morton.h"
+#include "strassen_prepared.h"
+#include <string.h>
+
+static const char* variantNames[NUM_VARIANTS] = { "standard", "classic", "seq", "morton", "prepared", "mpi1", "mpi" };
+
+
+void benchDefaults(BenchConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->sizes[0] = 256;
+    config->sizes[1] = 512;
+    config->sizes[2] = 1024;
+    config->num_sizes = 3;
+    config->cutoffs[0] = getSizeThreshold();
+    config->num_cutoffs = 1;
+    config->variants[0] = VARIANT_CLASSIC;
+    config->variants[1] = VARIANT_MPI1;
+    config->variants[2] = VARIANT_MPI;
+    config->num_variants = 3;
+    config->repeats = 5;
+    config->warmup = 1;
+    config->seed = 123;
+    config->csv_path = NULL;
+}
+
+
+int benchParseList(const char* text, int* values, int max_values) {
+    int count = 0;
+    const char* p = text;
+    while (*p) {
+        char* end;
+        long value = strtol(p, &end, 10);
+        if (end == p || value <= 0 || count == max_values || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        values[count++] = (int)value;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+
+int benchParseVariants(const char* text, int* variants) {
+    int count = 0;
+    const char* p = text;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        int found = -1;
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+            if (strlen(variantNames[v]) == len && strncmp(p, variantNames[v], len) == 0) {
+                found = v;
+            }
+        }
+        if (found < 0 || count == NUM_VARIANTS) {
+            return -1;
+        }
+        variants[count++] = found;
+        p += len;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return count;
+}
+
+
+double strassenFlopCount(int n, int cutoff) {
+    if (n <= cutoff || n == 1) {
+        return 2.0 * n * n * n;
+    }
+    double k = n / 2;
+    // 7 half-size products, 10 operand sums and 8 additions to form C
+    return 7.0 * strassenFlopCount(n / 2, cutoff) + 18.0 * k * k;
+}
+
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+// Time one configuration. Returns the per-repeat wall times on rank 0.
+static void timeVariant(int variant, elem_t** A, elem_t** B, int n, int repeats, int warmup,
+                        int rank, int num_procs, double* times) {
+    // A fixed left operand reused by every repetition, as in repeated products
+    PreparedOperand* prepared = NULL;
+    if (rank == 0 && variant == VARIANT_PREPARED) {
+        prepared = prepareOperand(A, n, PREPARED_LEFT);
+    }
+
+    for (int rep = -warmup; rep < repeats; rep++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        elem_t** C = NULL;
+
+        if (variant == VARIANT_MPI) {
+            C = runDistributedMultiply(A, B, n, rank, num_procs);
+        } else if (rank == 0 && variant == VARIANT_SEQ) {
+            C = strassenMultiply(A, B, n);
+        } else if (rank == 0 && variant == VARIANT_MORTON) {
+            C = mortonStrassen(A, B, n, SEQUENTIAL_CUTOFF);
+        } else if (rank == 0 && variant == VARIANT_PREPARED) {
+            C = strassenMultiplyPrepared(prepared, B);
+        } else if (rank == 0 && variant == VARIANT_STANDARD) {
+            C = standardMultiply(A, B, n);
+        } else if (rank == 0 && variant == VARIANT_CLASSIC) {
+            C = blockedMultiply(A, B, n);
+        } else if (rank == 0 && variant == VARIANT_MPI1) {
+            // A single-process tree: rank 0 has no children
+            C = strassenMultiplyMPI(A, B, n, 0, 1, 0);
+        }
+
+        double elapsed = MPI_Wtime() - start;
+        if (rep >= 0) {
+            times[rep] = elapsed;
+        }
+        if (C) {
+            freeMatrix(C, n);
+        }
+    }
+    freePreparedOperand(prepared);
+}
+
+
+void runBenchmark(const BenchConfig* config, int rank, int num_procs) {
+    FILE* csv = NULL;
+    double* times = (double*)malloc(config->repeats * sizeof(double));
+
+    if (rank == 0) {
+        if (config->csv_path) {
+            csv = fopen(config->csv_path, "a");
+            if (!csv) {
+                printf("WARNING: Cannot open %s, results go to stdout only\n", config->csv_path);
+            } else if (ftell(csv) == 0) {
+                fprintf(csv, "variant,elem,n,ranks,cutoff,repeats,median_s,min_s,mean_s,stddev_s,gflops,gflops_strassen,"
+                             "speedup_vs_mpi1,speedup_vs_classic,efficiency\n");
+            }
+        }
+        printf("%-9s %6s %5s %6s %12s %12s %12s %9s %9s %8s %8s %6s\n",
+               "variant", "n", "ranks", "cutoff", "median_s", "min_s", "stddev_s", "GFLOP/s", "Str-GF/s",
+               "vs-mpi1", "vs-clas", "eff");
+    }
+
+    for (int s = 0; s < config->num_sizes; s++) {
+        int n = config->sizes[s];
+        elem_t** A = generateMatrixDistributed(n, config->seed, rank, num_procs);
+        elem_t** B = generateMatrixDistributed(n, config->seed + 1, rank, num_procs);
+
+        // Baseline medians for the speedup columns; 0 when not measured
+        double classic_median = 0.0;
+        double mpi1_median[BENCH_MAX_VALUES] = { 0.0 };
+
+        for (int variant = 0; variant < NUM_VARIANTS; variant++) {
+            int selected = 0;
+            for (int v = 0; v < config->num_variants; v++) {
+                selected |= config->variants[v] == variant;
+            }
+            if (!selected) {
+                continue;
+            }
+            for (int c = 0; c < config->num_cutoffs; c++) {
+                int cutoff;
+                if (variant == VARIANT_MPI || variant == VARIANT_MPI1) {
+                    cutoff = config->cutoffs[c];
+                } else if (c == 0) {
+                    // The sequential variants have a fixed cutoff
+                    cutoff = variant == VARIANT_SEQ || variant == VARIANT_MORTON || variant == VARIANT_PREPARED
+                           ? SEQUENTIAL_CUTOFF
+                           : variant == VARIANT_CLASSIC ? GEMM_BLOCK_SIZE : n;
+                } else {
+                    continue;
+                }
+
+                int saved_threshold = getSizeThreshold();
+                setSizeThreshold(cutoff);
+                timeVariant(variant, A, B, n, config->repeats, config->warmup, rank, num_procs, times);
+                setSizeThreshold(saved_threshold);
+
+                if (rank != 0) {
+                    continue;
+                }
+
+                double mean = 0.0;
+                for (int r = 0; r < config->repeats; r++) {
+                    mean += times[r];
+                }
+                mean /= config->repeats;
+                double variance = 0.0;
+                for (int r = 0; r < config->repeats; r++) {
+                    variance += (times[r] - mean) * (times[r] - mean);
+                }
+                double stddev = config->repeats > 1 ? sqrt(variance / (config->repeats - 1)) : 0.0;
+
+                qsort(times, config->repeats, sizeof(double), compareDoubles);
+                double min = times[0];
+                double median = config->repeats % 2
+                    ? times[config->repeats / 2]
+                    : 0.5 * (times[config->repeats / 2 - 1] + times[config->repeats / 2]);
+
+                // Classical-equivalent rate, and the rate of operations Strassen actually performs
+                double gflops = 2.0 * n * (double)n * n / median * 1e-9;
+                double flops = variant == VARIANT_CLASSIC ? 2.0 * n * (double)n * n : strassenFlopCount(n, cutoff);
+                double gflops_strassen = flops / median * 1e-9;
+
+                if (variant == VARIANT_CLASSIC) {
+                    classic_median = median;
+                } else if (variant == VARIANT_MPI1) {
+                    mpi1_median[c] = median;
+                }
+
+                // Speedups of the distributed run over the baselines, all on the
+                // same wall clock; efficiency is relative to the 1-rank run
+                double speedup_mpi1 = 0.0;
+                double speedup_classic = 0.0;
+                double efficiency = 0.0;
+                if (variant == VARIANT_MPI) {
+                    if (mpi1_median[c] > 0.0) {
+                        speedup_mpi1 = mpi1_median[c] / median;
+                        efficiency = speedup_mpi1 / num_procs;
+                    }
+                    if (classic_median > 0.0) {
+                        speedup_classic = classic_median / median;
+                    }
+                }
+
+                printf("%-9s %6d %5d %6d %12.6f %12.6f %12.6f %9.3f %9.3f %8.2f %8.2f %6.2f\n",
+                       variantNames[variant], n, num_procs, cutoff, median, min, stddev, gflops, gflops_strassen,
+                       speedup_mpi1, speedup_classic, efficiency);
+                if (csv) {
+                    fprintf(csv, "%s,%s,%d,%d,%d,%d,%.9f,%.9f,%.9f,%.9f,%.6f,%.6f,%.4f,%.4f,%.4f\n",
+                            variantNames[variant], ELEM_NAME, n, num_procs, cutoff, config->repeats,
+                            median, min, mean, stddev, gflops, gflops_strassen,
+                            speedup_mpi1, speedup_classic, efficiency);
+                }
+            }
+        }
+
+        if (rank == 0) {
+            freeMatrix(A, n);
+            freeMatrix(B, n);
+        }
+    }
+
+    if (csv) {
+        fclose(csv);
+        printf("Results appended to %s\n", config->csv_path);
+    }
+    free(times);
+}
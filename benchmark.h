@@ -0,0 +1,50 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "strassen_mpi.h"
+
+#define BENCH_MAX_VALUES 16
+
+// Algorithm variants the benchmark can time, in the order they are run so
+// that the baselines are known before the distributed variant is reported
+typedef enum {
+    VARIANT_STANDARD,   // Naive standardMultiply on rank 0
+    VARIANT_CLASSIC,    // Cache-blocked classical blockedMultiply on rank 0
+    VARIANT_SEQ,        // Sequential strassenMultiply on rank 0
+    VARIANT_MORTON,     // Sequential mortonStrassen on rank 0, conversions included
+    VARIANT_PREPARED,   // strassenMultiplyPrepared on rank 0, A prepared once untimed
+    VARIANT_MPI1,       // strassenMultiplyMPI restricted to rank 0
+    VARIANT_MPI,        // strassenMultiplyMPI over all ranks
+    NUM_VARIANTS
+} BenchVariant;
+
+typedef struct {
+    int sizes[BENCH_MAX_VALUES];
+    int num_sizes;
+    int cutoffs[BENCH_MAX_VALUES];
+    int num_cutoffs;
+    int variants[NUM_VARIANTS];   // Selected variants (any order)
+    int num_variants;
+    int repeats;
+    int warmup;
+    unsigned long long seed;   // A uses seed, B uses seed + 1
+    const char* csv_path;   // Rows are appended; NULL prints to stdout only
+} BenchConfig;
+
+void benchDefaults(BenchConfig* config);
+
+// Parse a comma separated list such as "256,512,1024"; returns the count or
+// -1 if an entry is not a positive integer
+int benchParseList(const char* text, int* values, int max_values);
+
+// Parse a comma separated list of variant names; returns the count or -1
+int benchParseVariants(const char* text, int* variants);
+
+// Sweep sizes x cutoffs x variants. Must be called by all ranks with the
+// same configuration; rank 0 reports the results.
+void runBenchmark(const BenchConfig* config, int rank, int num_procs);
+
+// Arithmetic operations performed by Strassen recursing down to cutoff
+double strassenFlopCount(int n, int cutoff);
+
+#endif // BENCHMARK_H
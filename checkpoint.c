@@ -0,0 +1,252 @@
+// mkdir and strdup are POSIX, not C99
+#define _POSIX_C_SOURCE 200809L
+
+#include "checkpoint.h"
+#include "strassen_mpi.h"
+#include "modular.h"
+#include "mixed_precision.h"
+#include "comm.h"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define CHECKPOINT_MAGIC "STRCKPT1"
+
+// Ahead of the k x k elements of every checkpoint file
+typedef struct {
+    char magic[8];
+    int k;
+    int elem_size;
+    unsigned long long fingerprint;
+} CheckpointHeader;
+
+static char* checkpoint_dir = NULL;
+static unsigned long long fingerprint = 0;
+static int checkpoint_rank = 0;
+static long long num_loaded = 0;
+static long long num_saved = 0;
+static long long num_failed = 0;
+static long long crash_after = 0;
+
+
+// mkdir -p: create path and any missing parents
+static int makeDirectories(const char* path) {
+    char partial[4096];
+    size_t length = strlen(path);
+    if (length == 0 || length >= sizeof(partial)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    for (size_t i = 1; i <= length; i++) {
+        if (path[i] == '/' || path[i] == '\0') {
+            memcpy(partial, path, i);
+            partial[i] = '\0';
+            if (mkdir(partial, 0777) != 0 && errno != EEXIST) {
+                return 0;
+            }
+        }
+    }
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        return 0;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        errno = ENOTDIR;
+        return 0;
+    }
+    return 1;
+}
+
+
+int checkpointInit(const char* dir) {
+    free(checkpoint_dir);
+    checkpoint_dir = NULL;
+    if (!dir) {
+        return 1;
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &checkpoint_rank);
+
+    // Create the directory and prove it is writable before any work is done
+    char probe[4096];
+    snprintf(probe, sizeof(probe), "%s/.probe%d", dir, checkpoint_rank);
+    FILE* file = NULL;
+    if (makeDirectories(dir)) {
+        file = fopen(probe, "wb");
+    }
+    if (!file) {
+        fprintf(stderr, "Rank %d: cannot write checkpoints to %s: %s\n", checkpoint_rank, dir, strerror(errno));
+        return 0;
+    }
+    fclose(file);
+    remove(probe);
+    checkpoint_dir = strdup(dir);
+    return 1;
+}
+
+
+// Report the first failure on this rank; later ones are only counted
+static void saveFailed(const char* name) {
+    if (num_failed++ == 0) {
+        fprintf(stderr, "Rank %d: cannot save checkpoint %s: %s (further failures are counted only)\n",
+                checkpoint_rank, name, strerror(errno));
+    }
+}
+
+
+int checkpointEnabled(void) {
+    return checkpoint_dir != NULL;
+}
+
+
+// FNV-1a over raw bytes
+static unsigned long long hashBytes(unsigned long long h, const void* data, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+
+static void taskFileName(char* name, size_t size, int path, const char* suffix) {
+    snprintf(name, size, "%s/%016llx/task_%o.ckpt%s", checkpoint_dir, fingerprint, path, suffix);
+}
+
+
+void checkpointBegin(elem_t** A, elem_t** B, int n, int rank) {
+    if (!checkpoint_dir) {
+        return;
+    }
+    checkpoint_rank = rank;
+    if (rank == 0) {
+        // Anything that changes the products changes the fingerprint
+        int settings[6] = { n, (int)sizeof(elem_t), ELEM_IS_FLOAT, leaf_precision, getSizeThreshold(),
+                            payload_codec == PAYLOAD_BF16 };
+        unsigned long long h = 14695981039346656037ULL;
+        h = hashBytes(h, settings, sizeof(settings));
+        h = hashBytes(h, &strassen_modulus, sizeof(strassen_modulus));
+        for (int i = 0; i < n; i++) {
+            h = hashBytes(h, A[i], n * sizeof(elem_t));
+        }
+        for (int i = 0; i < n; i++) {
+            h = hashBytes(h, B[i], n * sizeof(elem_t));
+        }
+        fingerprint = h;
+    }
+    MPI_Bcast(&fingerprint, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    // Every rank writes its own files; an existing directory is fine
+    char name[4096];
+    snprintf(name, sizeof(name), "%s/%016llx", checkpoint_dir, fingerprint);
+    if (mkdir(name, 0777) != 0 && errno != EEXIST) {
+        saveFailed(name);
+    }
+}
+
+
+int checkpointChildPath(int path, int i) {
+    if (path < 0 || path > (INT_MAX - 8) / 8) {
+        return -1;
+    }
+    return path * 8 + i + 1;
+}
+
+
+// Whether the result of task path with size k is worth a file
+static int checkpointed(int path, int k) {
+    return checkpoint_dir != NULL && path >= 0 && k >= CHECKPOINT_MIN_SIZE;
+}
+
+
+elem_t** checkpointLoad(int path, int k) {
+    if (!checkpointed(path, k)) {
+        return NULL;
+    }
+    char name[4096];
+    taskFileName(name, sizeof(name), path, "");
+    FILE* file = fopen(name, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    CheckpointHeader header;
+    elem_t* flat = NULL;
+    elem_t** P = NULL;
+    if (fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(header.magic, CHECKPOINT_MAGIC, 8) == 0 &&
+        header.k == k && header.elem_size == (int)sizeof(elem_t) &&
+        header.fingerprint == fingerprint) {
+        flat = (elem_t*)malloc((size_t)k * k * sizeof(elem_t));
+        if (fread(flat, sizeof(elem_t), (size_t)k * k, file) == (size_t)k * k) {
+            P = unflattenMatrix(flat, k);
+            num_loaded++;
+        }
+        free(flat);
+    }
+    fclose(file);
+    return P;
+}
+
+
+void checkpointSave(int path, elem_t** P, int k) {
+    if (!checkpointed(path, k)) {
+        return;
+    }
+    char name[4096];
+    char tmp[4096];
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".tmp%d", checkpoint_rank);
+    taskFileName(name, sizeof(name), path, "");
+    taskFileName(tmp, sizeof(tmp), path, suffix);
+
+    FILE* file = fopen(tmp, "wb");
+    if (!file) {
+        saveFailed(tmp);
+        return;
+    }
+    CheckpointHeader header;
+    memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+    header.k = k;
+    header.elem_size = (int)sizeof(elem_t);
+    header.fingerprint = fingerprint;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; ok && i < k; i++) {
+        ok = fwrite(P[i], sizeof(elem_t), k, file) == (size_t)k;
+    }
+    ok = fclose(file) == 0 && ok;
+
+    // Only a complete file is ever visible under the final name
+    if (ok && rename(tmp, name) == 0) {
+        if (++num_saved == crash_after) {
+            fprintf(stderr, "Rank %d: crashing after %lld checkpoints (--crash-after)\n", checkpoint_rank, num_saved);
+            MPI_Abort(MPI_COMM_WORLD, 3);
+        }
+    } else {
+        saveFailed(name);
+        remove(tmp);
+    }
+}
+
+
+void checkpointRemove(int path, int k) {
+    if (!checkpointed(path, k)) {
+        return;
+    }
+    char name[4096];
+    taskFileName(name, sizeof(name), path, "");
+    remove(name);
+}
+
+
+void checkpointCounts(long long* loaded, long long* saved, long long* failed) {
+    *loaded = num_loaded;
+    *saved = num_saved;
+    *failed = num_failed;
+}
+
+
+void checkpointSetCrash(long long saves) {
+    crash_after = saves;
+}
@@ -0,0 +1,48 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "matrix_utils.h"
+
+// Checkpoint/restart at task granularity (--checkpoint-dir). Every call of
+// strassenMultiplyMPI is a task with a path id: the root is 0 and product i
+// of task p is task p * 8 + i + 1, so the octal digits of a path spell the
+// product numbers from the root down. A task saves each P_i as soon as it
+// has it and deletes them once they are combined into its result, which its
+// own parent then saves in turn. Files live in
+//   <dir>/<fingerprint>/task_<octal path>.ckpt
+// and the fingerprint hashes the operands, size, element type and arithmetic,
+// so running the same command again reloads finished tasks and recomputes
+// only the missing ones. Files are written to a temporary name and renamed
+// into place, so a crash never leaves a partial checkpoint behind.
+
+// Products smaller than this are recomputed rather than saved
+#define CHECKPOINT_MIN_SIZE 128
+
+// Enable checkpointing into dir, identical on all ranks. Creates dir with
+// any missing parents and checks that this rank can write there; returns 0
+// (with the reason on stderr) if not, leaving checkpointing off. NULL is
+// always fine.
+int checkpointInit(const char* dir);
+int checkpointEnabled(void);
+
+// Fingerprint the operands on rank 0 and share it. Collective; called at the
+// start of every distributed multiplication.
+void checkpointBegin(elem_t** A, elem_t** B, int n, int rank);
+
+// Path of product i of task path, or -1 when it is too deep to number
+int checkpointChildPath(int path, int i);
+
+// The k x k result of task path if it was saved, else NULL
+elem_t** checkpointLoad(int path, int k);
+void checkpointSave(int path, elem_t** P, int k);
+void checkpointRemove(int path, int k);
+
+// Products this rank loaded, saved and failed to save since checkpointInit.
+// The first failure is reported on stderr.
+void checkpointCounts(long long* loaded, long long* saved, long long* failed);
+
+// Testing aid (--crash-after): the first rank to save this many products
+// aborts the whole run, leaving its checkpoints behind for a rerun. 0 = never.
+void checkpointSetCrash(long long saves);
+
+#endif // CHECKPOINT_H
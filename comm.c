@@ -0,0 +1,203 @@
+#include "comm.h"
+#include "mixed_precision.h"
+#include <string.h>
+
+int payload_codec = PAYLOAD_RAW;
+
+// Packed payloads start with the frame of reference, padded so the bit
+// stream that follows is 8-byte aligned
+typedef struct {
+    long long min;
+    int bits;
+    int pad;
+} PackedPrefix;
+
+#define ELEM_BITS ((int)(8 * sizeof(elem_t)))
+
+
+int makeTag(int job, int level, int product, int kind) {
+    static int job_slots = 0;   // Job ids that fit below MPI_TAG_UB
+    if (job_slots == 0) {
+        // MPI guarantees MPI_TAG_UB >= 32767, which leaves 31 job slots
+        int* tag_ub;
+        int flag;
+        MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tag_ub, &flag);
+        long long room = (flag ? *tag_ub : 32767) - TAG_DYNAMIC_BASE + 1;
+        job_slots = (int)(room / (TAG_KINDS * 8 * TAG_LEVELS));
+    }
+    int slot = ((job % job_slots) * TAG_LEVELS + level % TAG_LEVELS) * 8 + product;
+    return TAG_DYNAMIC_BASE + slot * TAG_KINDS + kind;
+}
+
+
+int setPayloadCodec(int codec) {
+    if (codec == PAYLOAD_PACKED && ELEM_IS_FLOAT) {
+        return 0;
+    }
+    if (codec == PAYLOAD_BF16 && !ELEM_IS_FLOAT) {
+        return 0;
+    }
+    if (codec != PAYLOAD_RAW && codec != PAYLOAD_PACKED && codec != PAYLOAD_BF16) {
+        return 0;
+    }
+    payload_codec = codec;
+    return 1;
+}
+
+
+const char* payloadCodecName(int codec) {
+    switch (codec) {
+    case PAYLOAD_PACKED:
+        return "packed";
+    case PAYLOAD_BF16:
+        return "bf16 operands";
+    default:
+        return "raw";
+    }
+}
+
+
+// Rounding a product or quadrant to bf16 would cost far more accuracy than
+// rounding the operands it came from, so only operands travel as bf16
+int resultCodec(int codec) {
+    return codec == PAYLOAD_BF16 ? PAYLOAD_RAW : codec;
+}
+
+
+#if !ELEM_IS_FLOAT
+static size_t packedBytes(int count, int bits) {
+    size_t words = ((size_t)count * bits + 63) / 64;
+    return sizeof(PackedPrefix) + words * sizeof(unsigned long long);
+}
+
+
+// Encode data into a freshly allocated buffer; returns its size in *bytes
+static unsigned char* packPayload(const elem_t* data, int count, size_t* bytes) {
+    elem_t min = count > 0 ? data[0] : 0;
+    elem_t max = min;
+    for (int i = 1; i < count; i++) {
+        if (data[i] < min) {
+            min = data[i];
+        }
+        if (data[i] > max) {
+            max = data[i];
+        }
+    }
+
+    uelem_t range = (uelem_t)max - (uelem_t)min;
+    int bits = 0;
+    while (bits < ELEM_BITS && (range >> bits) != 0) {
+        bits++;
+    }
+
+    *bytes = packedBytes(count, bits);
+    unsigned char* buffer = (unsigned char*)calloc(1, *bytes);
+    PackedPrefix prefix = { (long long)min, bits, 0 };
+    memcpy(buffer, &prefix, sizeof(prefix));
+
+    unsigned long long* words = (unsigned long long*)(buffer + sizeof(PackedPrefix));
+    for (int i = 0; bits > 0 && i < count; i++) {
+        unsigned long long v = (unsigned long long)((uelem_t)data[i] - (uelem_t)min);
+        size_t pos = (size_t)i * bits;
+        size_t w = pos >> 6;
+        int offset = (int)(pos & 63);
+        words[w] |= v << offset;
+        if (offset + bits > 64) {
+            words[w + 1] |= v >> (64 - offset);
+        }
+    }
+    return buffer;
+}
+
+
+static void unpackPayload(const unsigned char* buffer, elem_t* data, int count) {
+    PackedPrefix prefix;
+    memcpy(&prefix, buffer, sizeof(prefix));
+    int bits = prefix.bits;
+    uelem_t min = (uelem_t)(elem_t)prefix.min;
+    unsigned long long mask = bits >= 64 ? ~0ULL : (1ULL << bits) - 1;
+
+    const unsigned long long* words = (const unsigned long long*)(buffer + sizeof(PackedPrefix));
+    for (int i = 0; i < count; i++) {
+        unsigned long long v = 0;
+        if (bits > 0) {
+            size_t pos = (size_t)i * bits;
+            size_t w = pos >> 6;
+            int offset = (int)(pos & 63);
+            v = words[w] >> offset;
+            if (offset + bits > 64) {
+                v |= words[w + 1] << (64 - offset);
+            }
+        }
+        data[i] = (elem_t)(min + (uelem_t)(v & mask));
+    }
+}
+#endif
+
+
+int payloadMaxBytes(int count, int codec) {
+#if !ELEM_IS_FLOAT
+    if (codec == PAYLOAD_PACKED) {
+        return (int)packedBytes(count, ELEM_BITS);
+    }
+#endif
+    if (codec == PAYLOAD_BF16) {
+        return count * (int)sizeof(bf16_t);
+    }
+    return count * (int)sizeof(elem_t);
+}
+
+
+long long sendPayload(const elem_t* data, int count, int codec, int dest, int tag) {
+    if (codec == PAYLOAD_BF16) {
+        bf16_t* buffer = (bf16_t*)malloc((count > 0 ? count : 1) * sizeof(bf16_t));
+        for (int i = 0; i < count; i++) {
+            buffer[i] = floatToBf16((float)data[i]);
+        }
+        MPI_Send(buffer, count, MPI_UNSIGNED_SHORT, dest, tag, MPI_COMM_WORLD);
+        free(buffer);
+        return (long long)count * sizeof(bf16_t);
+    }
+#if !ELEM_IS_FLOAT
+    if (codec == PAYLOAD_PACKED) {
+        size_t bytes;
+        unsigned char* buffer = packPayload(data, count, &bytes);
+        MPI_Send(buffer, (int)bytes, MPI_BYTE, dest, tag, MPI_COMM_WORLD);
+        free(buffer);
+        return (long long)bytes;
+    }
+#endif
+    (void)codec;
+    MPI_Send(data, count, MPI_ELEM, dest, tag, MPI_COMM_WORLD);
+    return (long long)count * sizeof(elem_t);
+}
+
+
+long long recvPayload(elem_t* data, int count, int codec, int source, int tag) {
+    if (codec == PAYLOAD_BF16) {
+        bf16_t* buffer = (bf16_t*)malloc((count > 0 ? count : 1) * sizeof(bf16_t));
+        MPI_Recv(buffer, count, MPI_UNSIGNED_SHORT, source, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        for (int i = 0; i < count; i++) {
+            data[i] = (elem_t)bf16ToFloat(buffer[i]);
+        }
+        free(buffer);
+        return (long long)count * sizeof(bf16_t);
+    }
+#if !ELEM_IS_FLOAT
+    if (codec == PAYLOAD_PACKED) {
+        // The size depends on the sender's range, so ask before receiving
+        MPI_Status status;
+        int bytes;
+        MPI_Probe(source, tag, MPI_COMM_WORLD, &status);
+        MPI_Get_count(&status, MPI_BYTE, &bytes);
+        unsigned char* buffer = (unsigned char*)malloc(bytes);
+        MPI_Recv(buffer, bytes, MPI_BYTE, source, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        unpackPayload(buffer, data, count);
+        free(buffer);
+        return bytes;
+    }
+#endif
+    (void)codec;
+    MPI_Recv(data, count, MPI_ELEM, source, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return (long long)count * sizeof(elem_t);
+}
@@ -0,0 +1,69 @@
+#ifndef COMM_H
+#define COMM_H
+
+#include "matrix_utils.h"
+
+// Work header sent as one int array ahead of the operands of every
+// assignment. The termination signal is a header with n = 0.
+#define HEADER_N         0   // Matrix size
+#define HEADER_PRODUCT   1   // Which product to compute (0-6 for P1-P7)
+#define HEADER_LEVEL     2   // Depth in the process tree
+#define HEADER_CODEC     3   // Codec of the operands; the child replies in resultCodec
+#define HEADER_COMBINE   4   // 1 if the children combine their products themselves
+#define HEADER_PATH      5   // Checkpoint path id of the product (checkpoint.h)
+#define HEADER_JOB       6   // Distributed multiplication the assignment belongs to
+#define WORK_HEADER_INTS 7
+
+// Every message of an assignment after its header carries a tag of its own,
+//   makeTag(job, level, product, kind)
+// so a receive can only match the message it is meant for, whatever order
+// traffic arrives in. Level is the parent's level and product the index of
+// the product the message belongs to (the quadrant for TAG_KIND_QUADRANT).
+// Tags start above TAG_DYNAMIC_BASE, clear of the fixed tags in
+// matrix_utils.h. Each job takes TAG_KINDS * 8 * TAG_LEVELS = 1024 tags, so
+// the job id wraps after (MPI_TAG_UB - TAG_DYNAMIC_BASE + 1) / 1024 jobs:
+// 31 at the standard's minimum MPI_TAG_UB of 32767, about two million with
+// Open MPI's 2^31 - 1. Jobs run one after another, so a job slot is only
+// reused once its traffic is long complete. Levels wrap modulo TAG_LEVELS.
+#define TAG_KIND_RESULT   0   // P_i, or the empty window completion, child to parent
+#define TAG_KIND_QUADRANT 1   // C quadrant, owner to parent (COMBINE_CHILDREN)
+#define TAG_KIND_COMBINE  2   // P_i, child to the sibling owning a quadrant
+#define TAG_KIND_OPERAND  3   // Plus q: quadrant chunk q (0-7), parent to child
+#define TAG_KINDS         16
+#define TAG_LEVELS        8
+#define TAG_DYNAMIC_BASE  1024
+
+int makeTag(int job, int level, int product, int kind);
+
+// Payload codecs
+#define PAYLOAD_RAW    0   // elem_t values as they are
+#define PAYLOAD_PACKED 1   // Frame of reference: min plus (value - min) in the
+                           // fewest bits that hold the observed range. Lossless;
+                           // integer element types only.
+#define PAYLOAD_WINDOW 2   // Operands and result stay in the parent's window
+                           // segment (window.h); chosen per child by the
+                           // parent, never requested on the command line
+#define PAYLOAD_BF16   3   // Operands rounded to bfloat16 on the wire, half
+                           // the bytes of fp32. Lossy; floating-point element
+                           // types only. Results come back raw.
+
+extern int payload_codec;
+
+// Select the codec parents offer their children. Must be identical on all
+// ranks. Returns 0 if the codec is not available for this element type.
+int setPayloadCodec(int codec);
+const char* payloadCodecName(int codec);
+
+// Send or receive count elements as one message in the given codec.
+// Both return the number of bytes that went over the wire.
+long long sendPayload(const elem_t* data, int count, int codec, int dest, int tag);
+long long recvPayload(elem_t* data, int count, int codec, int source, int tag);
+
+// Most bytes a payload of count elements can take in the given codec
+int payloadMaxBytes(int count, int codec);
+
+// Codec of the products and quadrants a child returns for operands that
+// arrived in codec
+int resultCodec(int codec);
+
+#endif // COMM_H
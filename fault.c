@@ -0,0 +1,279 @@
+// nanosleep is POSIX, not C99
+#define _POSIX_C_SOURCE 199309L
+
+#include "fault.h"
+#include "matrix_utils.h"
+#include <time.h>
+#include <pthread.h>
+
+#if defined(OPEN_MPI) && OPEN_MPI
+#include <mpi-ext.h>
+#endif
+
+double task_timeout = 0.0;
+int heartbeat_parent = -1;
+double heartbeat_due = 0.0;
+
+// Only the thread that called faultInit makes MPI calls (MPI_THREAD_FUNNELED)
+static pthread_t mpi_thread;
+
+// Polling interval of a parent waiting with a timeout
+#define FAULT_POLL_US 200
+
+// Abandoned requests get this many timeouts to complete in faultFinalize
+#define FAULT_GRACE_TIMEOUTS 10
+
+typedef struct {
+    MPI_Request request;
+    void* buffer;
+} Orphan;
+
+static int world_size = 0;
+static char* failed = NULL;          // FAILED_SILENT or FAILED_DEAD once this rank gave up on r
+static int num_failed = 0;
+static double* last_heard = NULL;    // When each peer last showed signs of life
+static Orphan* orphans = NULL;
+static int num_orphans = 0;
+static int stall_rank = -1;
+
+#define FAILED_SILENT 1   // Timed out; may still be alive
+#define FAILED_DEAD   2   // Reported dead by ULFM
+
+
+static void sleepSeconds(double seconds) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+
+void faultInit(double timeout, int num_procs) {
+    task_timeout = timeout;
+    mpi_thread = pthread_self();
+    world_size = num_procs;
+    failed = (char*)calloc(num_procs, 1);
+    last_heard = (double*)calloc(num_procs, sizeof(double));
+#if defined(OMPI_HAVE_MPI_EXT_FTMPI)
+    if (timeout > 0) {
+        MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_RETURN);
+    }
+#endif
+}
+
+
+int rankFailed(int rank) {
+    return rank >= 0 && rank < world_size && failed[rank];
+}
+
+
+int rankDead(int rank) {
+    return rank >= 0 && rank < world_size && failed[rank] == FAILED_DEAD;
+}
+
+
+void markRankFailed(int rank) {
+    if (!failed[rank]) {
+        failed[rank] = FAILED_SILENT;
+        num_failed++;
+    }
+}
+
+
+static void markRankDead(int rank) {
+    markRankFailed(rank);
+    failed[rank] = FAILED_DEAD;
+}
+
+
+int failedRankCount(void) {
+    return num_failed;
+}
+
+
+void heartbeatBegin(int parent) {
+    if (task_timeout > 0) {
+        heartbeat_parent = parent;
+        heartbeat_due = MPI_Wtime() + task_timeout / 4;
+    }
+}
+
+
+void heartbeatEnd(void) {
+    heartbeat_parent = -1;
+}
+
+
+void heartbeatSend(void) {
+    // Leaf kernels also run on task graph helper threads
+    if (!pthread_equal(pthread_self(), mpi_thread)) {
+        return;
+    }
+    MPI_Request request;
+    MPI_Isend(NULL, 0, MPI_INT, heartbeat_parent, TAG_HEARTBEAT, MPI_COMM_WORLD, &request);
+    MPI_Request_free(&request);
+    heartbeat_due = MPI_Wtime() + task_timeout / 4;
+}
+
+
+void faultExpect(int peer) {
+    last_heard[peer] = MPI_Wtime();
+}
+
+
+// Receive every heartbeat that has arrived and note the time
+static void drainHeartbeats(void) {
+    int flag;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_HEARTBEAT, MPI_COMM_WORLD, &flag, &status);
+    while (flag) {
+        MPI_Recv(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_HEARTBEAT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        last_heard[status.MPI_SOURCE] = MPI_Wtime();
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_HEARTBEAT, MPI_COMM_WORLD, &flag, &status);
+    }
+}
+
+
+// Whether an MPI return code reports a dead peer (ULFM only)
+static int procFailed(int rc) {
+#if defined(OMPI_HAVE_MPI_EXT_FTMPI)
+    int error_class;
+    MPI_Error_class(rc, &error_class);
+    return error_class == MPIX_ERR_PROC_FAILED;
+#else
+    (void)rc;
+    return 0;
+#endif
+}
+
+
+int faultWaitany(int count, MPI_Request requests[], const int peers[], void* buffers[], int* failed_out) {
+    *failed_out = 0;
+    if (task_timeout <= 0) {
+        int index;
+        MPI_Waitany(count, requests, &index, MPI_STATUS_IGNORE);
+        return index;
+    }
+
+    while (1) {
+        int index, flag;
+        int rc = MPI_Testany(count, requests, &index, &flag, MPI_STATUS_IGNORE);
+        if (rc != MPI_SUCCESS && procFailed(rc) && index != MPI_UNDEFINED) {
+            markRankDead(peers[index]);
+            faultAbandon(&requests[index], buffers[index]);
+            *failed_out = 1;
+            return index;
+        }
+        if (flag) {
+            return index;
+        }
+
+        drainHeartbeats();
+        heartbeatPoll();
+        double now = MPI_Wtime();
+        for (int i = 0; i < count; i++) {
+            if (requests[i] != MPI_REQUEST_NULL && now - last_heard[peers[i]] > task_timeout) {
+                markRankFailed(peers[i]);
+                faultAbandon(&requests[i], buffers[i]);
+                *failed_out = 1;
+                return i;
+            }
+        }
+        sleepSeconds(FAULT_POLL_US * 1e-6);
+    }
+}
+
+
+int faultProbe(int source, int tag) {
+    if (task_timeout <= 0) {
+        MPI_Probe(source, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        return 1;
+    }
+    while (1) {
+        int flag;
+        int rc = MPI_Iprobe(source, tag, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+        if (rc != MPI_SUCCESS && procFailed(rc)) {
+            markRankDead(source);
+            return 0;
+        }
+        if (flag) {
+            return 1;
+        }
+        drainHeartbeats();
+        heartbeatPoll();
+        if (MPI_Wtime() - last_heard[source] > task_timeout) {
+            markRankFailed(source);
+            return 0;
+        }
+        sleepSeconds(FAULT_POLL_US * 1e-6);
+    }
+}
+
+
+void faultAbandon(MPI_Request* request, void* buffer) {
+    orphans = (Orphan*)realloc(orphans, (num_orphans + 1) * sizeof(Orphan));
+    orphans[num_orphans].request = request ? *request : MPI_REQUEST_NULL;
+    orphans[num_orphans].buffer = buffer;
+    num_orphans++;
+    if (request) {
+        *request = MPI_REQUEST_NULL;
+    }
+}
+
+
+void faultSink(int source, int tag, int max_bytes) {
+    MPI_Request request;
+    void* buffer = malloc(max_bytes);
+    MPI_Irecv(buffer, max_bytes, MPI_BYTE, source, tag, MPI_COMM_WORLD, &request);
+    faultAbandon(&request, buffer);
+}
+
+
+void faultDrain(void) {
+    double deadline = MPI_Wtime() + FAULT_GRACE_TIMEOUTS * task_timeout;
+    for (int i = 0; i < num_orphans; i++) {
+        int done = 0;
+        while (!done && MPI_Wtime() < deadline) {
+            MPI_Test(&orphans[i].request, &done, MPI_STATUS_IGNORE);
+            if (!done) {
+                drainHeartbeats();
+                sleepSeconds(FAULT_POLL_US * 1e-6);
+            }
+        }
+        if (!done) {
+            MPI_Cancel(&orphans[i].request);
+            MPI_Wait(&orphans[i].request, MPI_STATUS_IGNORE);
+        }
+    }
+    for (int i = 0; i < num_orphans; i++) {
+        free(orphans[i].buffer);
+    }
+    free(orphans);
+    orphans = NULL;
+    num_orphans = 0;
+}
+
+
+void faultFinalize(void) {
+    faultDrain();
+    if (last_heard) {
+        drainHeartbeats();
+    }
+    free(failed);
+    free(last_heard);
+    failed = NULL;
+    last_heard = NULL;
+}
+
+
+void faultSetStall(int rank) {
+    stall_rank = rank;
+}
+
+
+void faultMaybeStall(int rank) {
+    if (rank == stall_rank) {
+        stall_rank = -1;
+        sleepSeconds(3 * task_timeout);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <mpi.h>
+
+// Recovery from children that hang or die. With a task timeout set, a parent
+// waits for each child's product only while the child shows signs of life:
+// a busy child sends its parent an empty TAG_HEARTBEAT message at least every
+// quarter of the timeout, from each recursion step, from every output row of
+// a leaf kernel and while it waits on children of its own. A child that stays silent for the whole timeout is
+// marked failed; the parent recomputes its product locally and never hands
+// it work again. Requests still pending towards it are kept, with their
+// buffers, until faultFinalize so a late reply lands somewhere harmless.
+//
+// Where Open MPI provides the ULFM extension (OMPI_HAVE_MPI_EXT_FTMPI), errors
+// on MPI_COMM_WORLD are returned instead of aborting the job, and a child
+// reported as MPIX_ERR_PROC_FAILED is treated like one that timed out. The
+// communicator is not shrunk: the survivors simply route around the dead rank.
+
+extern double task_timeout;   // Seconds; 0 (default) waits forever
+
+// Call once after MPI_Init, on all ranks, with the same timeout
+void faultInit(double timeout, int num_procs);
+
+int rankFailed(int rank);
+int rankDead(int rank);   // Failed and known to be gone (ULFM)
+void markRankFailed(int rank);
+int failedRankCount(void);
+
+// Worker side: heartbeats go to parent between heartbeatBegin and heartbeatEnd
+void heartbeatBegin(int parent);
+void heartbeatEnd(void);
+void heartbeatSend(void);
+
+extern int heartbeat_parent;
+extern double heartbeat_due;
+
+// Send a heartbeat if one is due; a single branch when timeouts are off.
+// Safe to call from any thread: only the one that called faultInit sends.
+static inline void heartbeatPoll(void) {
+    if (heartbeat_parent >= 0 && MPI_Wtime() >= heartbeat_due) {
+        heartbeatSend();
+    }
+}
+
+// Parent side: peer was just given work, so its silence is measured from now
+void faultExpect(int peer);
+
+// MPI_Waitany over requests whose peers are peers[i]. Returns the index of a
+// completed request, or MPI_UNDEFINED when none is active. If *failed is set
+// the returned entry's peer is silent or dead instead: the peer is marked
+// failed and its request handed to faultAbandon with buffers[i].
+int faultWaitany(int count, MPI_Request requests[], const int peers[], void* buffers[], int* failed);
+
+// MPI_Probe for a message from source, giving up and marking source failed
+// once it is silent for the timeout. Returns 1 if the message is there.
+int faultProbe(int source, int tag);
+
+// Keep a request that was given up on, and a buffer it may still use, until
+// faultFinalize. Either may be NULL.
+void faultAbandon(MPI_Request* request, void* buffer);
+
+// Post an abandoned receive for a reply from source that was given up on
+// before its receive was posted, so the late sender does not block
+void faultSink(int source, int tag, int max_bytes);
+
+// Let abandoned requests complete, for a grace period of ten timeouts after
+// which they are cancelled, and free their buffers. A parent calls this
+// before terminating its children, so a child it gave up on can still finish
+// using its own subtree.
+void faultDrain(void);
+
+// faultDrain, then drop stray heartbeats. Call before MPI_Finalize.
+void faultFinalize(void);
+
+// Testing aid (--stall): rank stalls without heartbeats for three timeouts
+// on its first assignment
+void faultSetStall(int rank);
+void faultMaybeStall(int rank);
+
+#endif // FAULT_H
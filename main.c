@@ -1,196 +1,568 @@
 #include "strassen_mpi.h"
+#include "benchmark.h"
+#include "verify.h"
+#include "random_matrix.h"
+#include "modular.h"
+#include "accuracy.h"
+#include "mixed_precision.h"
+#include "comm.h"
+#include "window.h"
+#include "topology.h"
+#include "fault.h"
+#include "checkpoint.h"
+#include "task_dag.h"
+#include "morton.h"
+#include "alloc.h"
+#include <string.h>
 #include <time.h>
 
-void initializeRandomMatrix(int** matrix, int n, int seed);
-double verifyResult(int** A, int** B, int** C, int n);
-void workerProcess(int rank, int num_procs);
+void printUsage(const char* program) {
+    printf("Usage: %s [matrix_size] [options]\n", program);
+    printf("Options:\n");
+    printf("  --profile <file>   Write per-rank phase timings (CSV, or JSON for *.json)\n");
+    printf("  --trace <file>     Write a Chrome trace JSON timeline of tasks and messages\n");
+    printf("  --verify <mode>    freivalds (default), exact (distributed), seq, prepared or none\n");
+    printf("  --seed <s>         Inputs are A = seed, B = seed + 1 (default 123)\n");
+    printf("  --cutoff <n>       Size at or below which products are not split (default %d)\n", MIN_SIZE_THRESHOLD);
+    printf("  --mod <p>          Compute the product modulo p (2 <= p <= 2^30)\n");
+    printf("  --crt <k>          Exact product from k prime moduli (0 = as many as needed)\n");
+    printf("  --tolerance <t>    Floating point: limit depth so |C - AB| <= t * max|A| * max|B|\n");
+    printf("  --scale            Floating point: power-of-two row/column scaling of A and B\n");
+    printf("  --leaf <p>         Floating point leaf kernel: native (default) or bf16 (an accuracy\n");
+    printf("                     emulation, slower than native, unless built with AVX-512 BF16)\n");
+    printf("  --compress <c>     Operand/result messages: raw (default), packed (integer types, lossless)\n");
+    printf("                     or bf16 (floating point, operands rounded to bf16 on the wire)\n");
+    printf("  --transport <t>    msg (default), shm (node-local shared windows) or rma (MPI_Get/MPI_Put)\n");
+    printf("  --combine <c>      Form C11..C22 on the parent (default) or on the children\n");
+    printf("  --timeout <s>      Give up on a child silent for s seconds and recompute its product\n");
+    printf("  --stall <rank>     Testing: rank stalls for three timeouts on its first assignment\n");
+    printf("  --checkpoint-dir <d>  Save finished products under d; a rerun reloads them\n");
+    printf("  --crash-after <n>  Testing: abort the run once a rank has saved n checkpoints\n");
+    printf("  --threads <t>      Run each rank's local subtree as a task graph on t threads\n");
+    printf("  --layout <l>       Local subtree storage: rows (default) or morton (Z-order blocks)\n");
+    printf("  --alloc <a>        Large matrices on plain (default) or huge (2M/1G) pages\n");
+    printf("  --numa             Allocate on the allocating thread's NUMA node; per-node thread queues\n");
+    printf("  --mapping <m>      Tree placement: topo (default, keeps top levels on a node) or linear\n");
+    printf("  --ranks-per-node <k>  Treat blocks of k ranks as nodes when placing the tree\n");
+    printf("Benchmark mode:\n");
+    printf("  --bench            Sweep the settings below instead of a single run\n");
+    printf("  --sizes <list>     Matrix sizes, e.g. 256,512,1024\n");
+    printf("  --cutoffs <list>   Cutoffs to sweep for the mpi variant\n");
+    printf("  --variants <list>  Any of mpi,mpi1,seq,morton,prepared,classic,standard (default classic,mpi1,mpi)\n");
+    printf("  --repeats <n>      Timed repetitions per configuration (default 5)\n");
+    printf("  --warmup <n>       Untimed repetitions before timing (default 1)\n");
+    printf("  --csv <file>       Append results as CSV rows\n");
+}
+
+
+// Report a command line error on rank 0 and shut down
+int usageError(const char* program, const char* message, const char* arg, int rank) {
+    if (rank == 0) {
+        printf("Error: %s%s\n", message, arg ? arg : "");
+        printUsage(program);
+    }
+    MPI_Finalize();
+    return 0;
+}
 
 
 int main(int argc, char* argv[]) {
     int rank, num_procs;
     int n = 4;
-
-    MPI_Init(&argc, &argv);
+    const char* profile_path = NULL;
+    const char* trace_path = NULL;
+    int bench = 0;
+    int verify_mode = VERIFY_FREIVALDS;
+    unsigned long long seed = 123;
+    int crt_primes = -1;
+    int mapping = MAPPING_TOPOLOGY;
+    int ranks_per_node = 0;
+    double tolerance = 0.0;
+    int scale = 0;
+    double timeout = 0.0;
+    int stall = -1;
+    const char* checkpoint_dir = NULL;
+    long long crash_after = 0;
+    BenchConfig bench_config;
+
+    // Task graph threads never call MPI themselves (task_dag.h)
+    int thread_support;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
 
-    if (argc > 1) {
-        n = atoi(argv[1]);
-        if (!isPowerOfTwo(n) || n < 2) {
-            if (rank == 0) {
-                printf("Error: Matrix size must be a power of 2 and >= 2\n");
-                printf("Usage: %s [matrix_size]\n", argv[0]);
+    benchDefaults(&bench_config);
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--profile") == 0 && a + 1 < argc) {
+            profile_path = argv[++a];
+        } else if (strcmp(argv[a], "--trace") == 0 && a + 1 < argc) {
+            trace_path = argv[++a];
+        } else if (strcmp(argv[a], "--cutoff") == 0 && a + 1 < argc) {
+            int cutoff = atoi(argv[++a]);
+            if (cutoff < 1) {
+                return usageError(argv[0], "Invalid cutoff ", argv[a], rank);
             }
-            MPI_Finalize();
-            return 0;
+            setSizeThreshold(cutoff);
+            bench_config.cutoffs[0] = cutoff;
+        } else if (strcmp(argv[a], "--verify") == 0 && a + 1 < argc) {
+            const char* mode = argv[++a];
+            if (strcmp(mode, "freivalds") == 0) {
+                verify_mode = VERIFY_FREIVALDS;
+            } else if (strcmp(mode, "exact") == 0) {
+                verify_mode = VERIFY_EXACT;
+            } else if (strcmp(mode, "seq") == 0) {
+                verify_mode = VERIFY_SEQUENTIAL;
+            } else if (strcmp(mode, "prepared") == 0) {
+                verify_mode = VERIFY_PREPARED;
+            } else if (strcmp(mode, "none") == 0) {
+                verify_mode = VERIFY_NONE;
+            } else {
+                return usageError(argv[0], "Unknown verification mode ", mode, rank);
+            }
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            seed = strtoull(argv[++a], NULL, 10);
+            bench_config.seed = seed;
+        } else if (strcmp(argv[a], "--mod") == 0 && a + 1 < argc) {
+            elem_t p = (elem_t)strtoll(argv[++a], NULL, 10);
+            if (p < 2 || !setModulus(p)) {
+                return usageError(argv[0], "Invalid modulus ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--crt") == 0 && a + 1 < argc) {
+            crt_primes = atoi(argv[++a]);
+            if (crt_primes < 0 || crt_primes > CRT_MAX_PRIMES || ELEM_IS_FLOAT) {
+                return usageError(argv[0], "Invalid prime count ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--tolerance") == 0 && a + 1 < argc) {
+            tolerance = atof(argv[++a]);
+            if (!ELEM_IS_FLOAT || tolerance <= 0) {
+                return usageError(argv[0], "Tolerance needs a positive value and make ELEM=double: ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--scale") == 0) {
+            if (!ELEM_IS_FLOAT) {
+                return usageError(argv[0], "--scale needs a floating-point build (make ELEM=double)", NULL, rank);
+            }
+            scale = 1;
+        } else if (strcmp(argv[a], "--leaf") == 0 && a + 1 < argc) {
+            const char* precision = argv[++a];
+            int ok = 0;
+            if (strcmp(precision, "native") == 0) {
+                ok = setLeafPrecision(LEAF_NATIVE);
+            } else if (strcmp(precision, "bf16") == 0) {
+                ok = setLeafPrecision(LEAF_BF16);
+            }
+            if (!ok) {
+                return usageError(argv[0], "Unsupported leaf precision ", precision, rank);
+            }
+        } else if (strcmp(argv[a], "--compress") == 0 && a + 1 < argc) {
+            const char* codec = argv[++a];
+            int ok = 0;
+            if (strcmp(codec, "raw") == 0) {
+                ok = setPayloadCodec(PAYLOAD_RAW);
+            } else if (strcmp(codec, "packed") == 0) {
+                ok = setPayloadCodec(PAYLOAD_PACKED);
+            } else if (strcmp(codec, "bf16") == 0) {
+                ok = setPayloadCodec(PAYLOAD_BF16);
+            }
+            if (!ok) {
+                return usageError(argv[0], "Unsupported payload codec ", codec, rank);
+            }
+        } else if (strcmp(argv[a], "--transport") == 0 && a + 1 < argc) {
+            const char* name = argv[++a];
+            if (strcmp(name, "msg") == 0) {
+                transport = TRANSPORT_MSG;
+            } else if (strcmp(name, "shm") == 0) {
+                transport = TRANSPORT_SHM;
+            } else if (strcmp(name, "rma") == 0) {
+                transport = TRANSPORT_RMA;
+            } else {
+                return usageError(argv[0], "Unknown transport ", name, rank);
+            }
+        } else if (strcmp(argv[a], "--combine") == 0 && a + 1 < argc) {
+            const char* name = argv[++a];
+            if (strcmp(name, "parent") == 0) {
+                setCombineMode(COMBINE_PARENT);
+            } else if (strcmp(name, "children") == 0) {
+                setCombineMode(COMBINE_CHILDREN);
+            } else {
+                return usageError(argv[0], "Unknown combine mode ", name, rank);
+            }
+        } else if (strcmp(argv[a], "--timeout") == 0 && a + 1 < argc) {
+            timeout = atof(argv[++a]);
+            if (timeout <= 0) {
+                return usageError(argv[0], "Invalid timeout ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--stall") == 0 && a + 1 < argc) {
+            stall = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--checkpoint-dir") == 0 && a + 1 < argc) {
+            checkpoint_dir = argv[++a];
+        } else if (strcmp(argv[a], "--crash-after") == 0 && a + 1 < argc) {
+            crash_after = atoll(argv[++a]);
+            if (crash_after < 1) {
+                return usageError(argv[0], "Invalid checkpoint count ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            int threads = atoi(argv[++a]);
+            if (threads < 1) {
+                return usageError(argv[0], "Invalid thread count ", argv[a], rank);
+            }
+            setDagThreads(threads);
+        } else if (strcmp(argv[a], "--alloc") == 0 && a + 1 < argc) {
+            const char* name = argv[++a];
+            if (strcmp(name, "plain") == 0) {
+                alloc_mode = ALLOC_PLAIN;
+            } else if (strcmp(name, "huge") == 0) {
+                alloc_mode = ALLOC_HUGE;
+            } else {
+                return usageError(argv[0], "Unknown allocator ", name, rank);
+            }
+        } else if (strcmp(argv[a], "--numa") == 0) {
+            // Count the nodes now, before any thread allocates
+            alloc_numa = 1;
+            numaNodeCount();
+        } else if (strcmp(argv[a], "--layout") == 0 && a + 1 < argc) {
+            const char* name = argv[++a];
+            if (strcmp(name, "rows") == 0) {
+                matrix_layout = LAYOUT_ROW_MAJOR;
+            } else if (strcmp(name, "morton") == 0) {
+                matrix_layout = LAYOUT_MORTON;
+            } else {
+                return usageError(argv[0], "Unknown layout ", name, rank);
+            }
+        } else if (strcmp(argv[a], "--mapping") == 0 && a + 1 < argc) {
+            const char* name = argv[++a];
+            if (strcmp(name, "topo") == 0) {
+                mapping = MAPPING_TOPOLOGY;
+            } else if (strcmp(name, "linear") == 0) {
+                mapping = MAPPING_LINEAR;
+            } else {
+                return usageError(argv[0], "Unknown mapping ", name, rank);
+            }
+        } else if (strcmp(argv[a], "--ranks-per-node") == 0 && a + 1 < argc) {
+            ranks_per_node = atoi(argv[++a]);
+            if (ranks_per_node < 1) {
+                return usageError(argv[0], "Invalid ranks per node ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--bench") == 0) {
+            bench = 1;
+        } else if (strcmp(argv[a], "--sizes") == 0 && a + 1 < argc) {
+            bench_config.num_sizes = benchParseList(argv[++a], bench_config.sizes, BENCH_MAX_VALUES);
+            for (int i = 0; i < bench_config.num_sizes; i++) {
+                if (!isPowerOfTwo(bench_config.sizes[i]) || bench_config.sizes[i] < 2) {
+                    bench_config.num_sizes = -1;
+                }
+            }
+            if (bench_config.num_sizes <= 0) {
+                return usageError(argv[0], "Invalid size list ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--cutoffs") == 0 && a + 1 < argc) {
+            bench_config.num_cutoffs = benchParseList(argv[++a], bench_config.cutoffs, BENCH_MAX_VALUES);
+            if (bench_config.num_cutoffs <= 0) {
+                return usageError(argv[0], "Invalid cutoff list ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--variants") == 0 && a + 1 < argc) {
+            bench_config.num_variants = benchParseVariants(argv[++a], bench_config.variants);
+            if (bench_config.num_variants <= 0) {
+                return usageError(argv[0], "Invalid variant list ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--repeats") == 0 && a + 1 < argc) {
+            bench_config.repeats = atoi(argv[++a]);
+            if (bench_config.repeats < 1) {
+                return usageError(argv[0], "Invalid repeat count ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--warmup") == 0 && a + 1 < argc) {
+            bench_config.warmup = atoi(argv[++a]);
+            if (bench_config.warmup < 0) {
+                return usageError(argv[0], "Invalid warmup count ", argv[a], rank);
+            }
+        } else if (strcmp(argv[a], "--csv") == 0 && a + 1 < argc) {
+            bench_config.csv_path = argv[++a];
+        } else if (argv[a][0] != '-') {
+            n = atoi(argv[a]);
+            if (!isPowerOfTwo(n) || n < 2) {
+                return usageError(argv[0], "Matrix size must be a power of 2 and >= 2", NULL, rank);
+            }
+        } else {
+            return usageError(argv[0], "Unknown option ", argv[a], rank);
         }
     }
 
-    if (rank == 0) {
-        printf("=== MPI Strassen Matrix Multiplication ===\n");
-        printf("Matrix size: %dx%d\n", n, n);
-        printf("Number of processes: %d\n", num_procs);
-        printf("Tree height limit: %d\n", MAX_TREE_HEIGHT);
-        printf("Sequential threshold: %d\n", MIN_SIZE_THRESHOLD);
-        printf("==========================================\n\n");
-
-        int** A = initializeMatrix(n);
-        int** B = initializeMatrix(n);
-
-        initializeRandomMatrix(A, n, 123);
-        initializeRandomMatrix(B, n, 456);
+    if (crt_primes >= 0 && strassen_modulus) {
+        return usageError(argv[0], "--mod and --crt cannot be combined", NULL, rank);
+    }
+    if (bench && (crt_primes >= 0 || strassen_modulus || tolerance > 0 || scale || checkpoint_dir)) {
+        return usageError(argv[0], "--mod, --crt, --tolerance, --scale and --checkpoint-dir are not supported with --bench",
+                          NULL, rank);
+    }
 
-        if (n <= 8) {
-            printMatrix(A, n, "A");
-            printMatrix(B, n, "B");
+    // Helper threads must not run beside an MPI that only supports one thread
+    if (dag_threads > 1 && thread_support < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            printf("WARNING: MPI provides no MPI_THREAD_FUNNELED support; running with --threads 1\n");
         }
+        setDagThreads(1);
+    }
+    if (dag_threads > 1 && matrix_layout == LAYOUT_MORTON) {
+        return usageError(argv[0], "--threads and --layout morton cannot be combined", NULL, rank);
+    }
+    // The local engines do not save the products inside their subtree
+    if (checkpoint_dir && (dag_threads > 1 || matrix_layout == LAYOUT_MORTON)) {
+        return usageError(argv[0], "--checkpoint-dir cannot be combined with --threads or --layout morton", NULL, rank);
+    }
 
-        clock_t start_time = clock();
-        double mpi_start_time = MPI_Wtime();
-
-        printf("Starting MPI Strassen multiplication...\n");
-        int** C = strassenMultiplyMPI(A, B, n, rank, num_procs, 0);
+    // A child that is given up on may still write into a window segment later
+    if (timeout > 0 && transport != TRANSPORT_MSG) {
+        return usageError(argv[0], "--timeout requires --transport msg", NULL, rank);
+    }
+    if (stall >= 0 && timeout <= 0) {
+        return usageError(argv[0], "--stall requires --timeout", NULL, rank);
+    }
+    if (crash_after > 0 && !checkpoint_dir) {
+        return usageError(argv[0], "--crash-after requires --checkpoint-dir", NULL, rank);
+    }
 
-        double mpi_end_time = MPI_Wtime();
-        clock_t end_time = clock();
+    // The error bound grows with every level, so a tolerance caps the depth by
+    // raising the cutoff
+    if (tolerance > 0) {
+        int tolerance_cutoff = cutoffForTolerance(n, tolerance);
+        if (tolerance_cutoff > getSizeThreshold()) {
+            setSizeThreshold(tolerance_cutoff);
+        }
+    }
 
-        double cpu_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
-        double wall_time = mpi_end_time - mpi_start_time;
+    topologyInit(mapping, ranks_per_node, rank, num_procs);
+    faultInit(timeout, num_procs);
+    faultSetStall(stall);
+    int checkpoint_ok = checkpointInit(checkpoint_dir);
+    MPI_Allreduce(MPI_IN_PLACE, &checkpoint_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!checkpoint_ok) {
+        return usageError(argv[0], "Cannot write checkpoints to ", checkpoint_dir, rank);
+    }
+    checkpointSetCrash(crash_after);
 
-        printf("MPI Strassen multiplication completed!\n");
-        printf("CPU Time: %.6f seconds\n", cpu_time);
-        printf("Wall Time: %.6f seconds\n", wall_time);
+    if (profile_path) {
+        profileEnable();
+    }
+    if (trace_path) {
+        traceEnable(num_procs);
+    }
 
-        if (n <= 8) {
-            printMatrix(C, n, "Result C");
+    elem_t** A = NULL;
+    elem_t** B = NULL;
+    elem_t** C = NULL;
+    double generate_time = 0.0;
+    int overflow_possible = 0;
+
+    if (!bench) {
+        // Every rank generates a block of rows of A and B; rank 0 collects them
+        double generate_start = MPI_Wtime();
+        A = generateMatrixDistributed(n, seed, rank, num_procs);
+        B = generateMatrixDistributed(n, seed + 1, rank, num_procs);
+        generate_time = MPI_Wtime() - generate_start;
+        if (rank == 0 && strassen_modulus) {
+            reduceMatrix(A, n, strassen_modulus);
+            reduceMatrix(B, n, strassen_modulus);
         }
+    }
 
-        if (n <= 2048) {
-            double verify_time = verifyResult(A, B, C, n);
-            if (verify_time > 0) {
-                printf("Speedup: %.2fx\n", verify_time / wall_time);
+    if (bench) {
+        if (rank == 0) {
+            printf("=== MPI Strassen Benchmark (%d processes) ===\n", num_procs);
+        }
+        runBenchmark(&bench_config, rank, num_procs);
+    } else {
+        if (rank == 0) {
+            printf("=== MPI Strassen Matrix Multiplication ===\n");
+            printf("Matrix size: %dx%d\n", n, n);
+            printf("Number of processes: %d\n", num_procs);
+            printf("Tree height limit: %d\n", MAX_TREE_HEIGHT);
+            printf("Sequential threshold: %d\n", getSizeThreshold());
+            printf("Input seed: %llu\n", seed);
+            printf("Element type: %s\n", ELEM_NAME);
+            printf("Payload codec: %s\n", payloadCodecName(payload_codec));
+            printf("Tree mapping: %s, %d of %d edges cross nodes\n",
+                   mapping == MAPPING_TOPOLOGY ? "topology-aware" : "linear", crossNodeEdges(), num_procs - 1);
+            printf("Transport: %s\n", transport == TRANSPORT_SHM ? "shared memory within nodes" :
+                                       transport == TRANSPORT_RMA ? "one-sided MPI_Get/MPI_Put" : "messages");
+            printf("Combination: %s\n", getCombineMode() == COMBINE_CHILDREN ? "on the children" : "on the parent");
+            if (strassen_modulus) {
+                printf("Arithmetic: modulo %" ELEM_FMT "\n", strassen_modulus);
+            } else if (crt_primes >= 0) {
+                printf("Arithmetic: exact, Chinese remainder over prime moduli\n");
+            }
+            printf("==========================================\n\n");
+            printf("Input generation time: %.6f seconds\n", generate_time);
+
+#if ELEM_IS_FLOAT
+            double max_a = (double)maxAbsElement(A, n);
+            double max_b = (double)maxAbsElement(B, n);
+            if (tolerance > 0) {
+                printf("Tolerance %.3g: cutoff %d\n", tolerance, getSizeThreshold());
+                if (strassenErrorBound(n, n, 1.0, 1.0) > tolerance) {
+                    printf("WARNING: Even classical multiplication cannot guarantee this tolerance\n");
+                }
+            }
+            printf("Leaf kernel: %s\n", leafPrecisionName(leaf_precision));
+            printf("Error bound: |C - AB| <= %.3g (%.3g * max|A| * max|B|)%s\n",
+                   strassenErrorBound(n, getSizeThreshold(), max_a, max_b),
+                   strassenErrorBound(n, getSizeThreshold(), 1.0, 1.0), scale ? ", before scaling" : "");
+#else
+            // Prove from the input range that no intermediate can overflow elem_t.
+            // Modular and CRT runs keep every intermediate below p instead.
+            double bound = strassenMagnitudeBound(n, getSizeThreshold(),
+                                                  (double)maxAbsElement(A, n), (double)maxAbsElement(B, n));
+            if (strassen_modulus || crt_primes >= 0) {
+                printf("Overflow check: intermediates reduced below the modulus\n");
+            } else if (bound > ELEM_MAX) {
+                printf("Error: Intermediate values may reach %.3g and overflow %s; rebuild with make ELEM=int64 or use --crt\n",
+                       bound, ELEM_NAME);
+                overflow_possible = 1;
             } else {
-                printf("WARNING: Verification time invalid.\n");
+                printf("Overflow check: intermediates bounded by %.3g, safe for %s\n", bound, ELEM_NAME);
             }
-        }
-
-        freeMatrix(A, n);
-        freeMatrix(B, n);
-        freeMatrix(C, n);
+#endif
 
-        int terminate = 0;
-        for (int i = 1; i < num_procs; i++) {
-            MPI_Send(&terminate, 1, MPI_INT, i, TAG_WORK, MPI_COMM_WORLD);
+            if (n <= 8) {
+                printMatrix(A, n, "A");
+                printMatrix(B, n, "B");
+            }
+            if (!overflow_possible) {
+                printf("Starting MPI Strassen multiplication...\n");
+            }
         }
-    } else {
-        workerProcess(rank, num_procs);
-    }
 
-    MPI_Finalize();
-    return 0;
-}
-
-
-void workerProcess(int rank, int num_procs) {
-    while (1) {
-        MPI_Status status;
-        int n, product_index, level;
-
-        // Try to receive matrix size
-        MPI_Recv(&n, 1, MPI_INT, MPI_ANY_SOURCE, TAG_WORK, MPI_COMM_WORLD, &status);
-
-        // Check if this is a termination signal (n = 0)
-        if (n == 0) {
-            break;
+        // The integer builds only run when the bound proves the result exact;
+        // wrapped intermediates would otherwise corrupt C silently
+        MPI_Bcast(&overflow_possible, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (overflow_possible) {
+            if (rank == 0) {
+                freeMatrix(A, n);
+                freeMatrix(B, n);
+            }
+            MPI_Finalize();
+            return 1;
         }
 
-        int parent_rank = status.MPI_SOURCE;
-
-        // Receive product index and level
-        MPI_Recv(&product_index, 1, MPI_INT, parent_rank, TAG_WORK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        MPI_Recv(&level, 1, MPI_INT, parent_rank, TAG_WORK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        clock_t start_time = clock();
+        double mpi_start_time = MPI_Wtime();
 
-        // Receive matrices A and B
-        int* flatA = (int*)malloc(n * n * sizeof(int));
-        int* flatB = (int*)malloc(n * n * sizeof(int));
+        DiagonalScaling* scaling = NULL;
+        if (rank == 0 && scale) {
+            scaling = scaleOperands(A, B, n);
+        }
 
-        MPI_Recv(flatA, n * n, MPI_INT, parent_rank, TAG_WORK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        MPI_Recv(flatB, n * n, MPI_INT, parent_rank, TAG_WORK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (crt_primes >= 0) {
+            C = crtMultiply(A, B, n, crt_primes, rank, num_procs);
+        } else {
+            C = runDistributedMultiply(A, B, n, rank, num_procs);
+        }
 
-        // Unflatten matrices
-        int** A = unflattenMatrix(flatA, n);
-        int** B = unflattenMatrix(flatB, n);
-        free(flatA);
-        free(flatB);
+        if (scaling) {
+            unscaleResult(scaling, A, B, C);
+        }
 
-        // Divide into quadrants
-        int k = n / 2;
-        int** A11 = initializeMatrix(k);
-        int** A12 = initializeMatrix(k);
-        int** A21 = initializeMatrix(k);
-        int** A22 = initializeMatrix(k);
-        int** B11 = initializeMatrix(k);
-        int** B12 = initializeMatrix(k);
-        int** B21 = initializeMatrix(k);
-        int** B22 = initializeMatrix(k);
+        double mpi_end_time = MPI_Wtime();
+        clock_t end_time = clock();
 
-        splitMatrix(A, A11, A12, A21, A22, k);
-        splitMatrix(B, B11, B12, B21, B22, k);
+        if (checkpoint_dir) {
+            long long counts[3], totals[3] = { 0, 0, 0 };
+            checkpointCounts(&counts[0], &counts[1], &counts[2]);
+            MPI_Reduce(counts, totals, 3, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+            if (rank == 0) {
+                printf("Checkpoints: %lld products reloaded, %lld saved", totals[0], totals[1]);
+                if (totals[2] > 0) {
+                    printf(", %lld FAILED to save", totals[2]);
+                }
+                printf("\n");
+            }
+        }
+        if (alloc_mode == ALLOC_HUGE) {
+            long long counts[2], totals[2] = { 0, 0 };
+            allocCounts(&counts[0], &counts[1]);
+            MPI_Reduce(counts, totals, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+            if (rank == 0) {
+                printf("Huge pages: %lld blocks mapped on huge pages, %lld advised (transparent)\n",
+                       totals[0], totals[1]);
+            }
+        }
+        if (timeout > 0) {
+            int lost = failedRankCount();
+            int total_lost = 0;
+            MPI_Reduce(&lost, &total_lost, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+            if (rank == 0 && total_lost > 0) {
+                printf("Gave up on %d unresponsive child(ren); their products were recomputed\n", total_lost);
+            }
+        }
 
-        // Compute the specific product based on product_index
-        int** result = computeStrassenProductMPI(A11, A12, A21, A22, B11, B12, B21, B22,
-                                                  k, rank, num_procs, level + 1, product_index);
+        if (rank == 0) {
+            double cpu_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+            double wall_time = mpi_end_time - mpi_start_time;
 
-        // Send result back to parent
-        int* flatResult = flattenMatrix(result, k);
-        MPI_Send(flatResult, k * k, MPI_INT, parent_rank, TAG_WORK, MPI_COMM_WORLD);
+            printf("MPI Strassen multiplication completed!\n");
+            printf("CPU Time: %.6f seconds\n", cpu_time);
+            printf("Wall Time: %.6f seconds\n", wall_time);
 
-        free(flatResult);
-        freeMatrix(A, n);
-        freeMatrix(B, n);
-        freeMatrix(A11, k); freeMatrix(A12, k); freeMatrix(A21, k); freeMatrix(A22, k);
-        freeMatrix(B11, k); freeMatrix(B12, k); freeMatrix(B21, k); freeMatrix(B22, k);
-        freeMatrix(result, k);
-    }
-}
+            if (n <= 8) {
+                printMatrix(C, n, "Result C");
+            }
 
-void initializeRandomMatrix(int** matrix, int n, int seed) {
-    srand(seed);
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            matrix[i][j] = rand() % 10; // Values 0-9 for easy verification
+            if (verify_mode == VERIFY_SEQUENTIAL) {
+                double verify_time = verifyResult(A, B, C, n);
+                if (verify_time > 0) {
+                    // Both times are wall clock; use --bench for speedup and efficiency
+                    // against the 1-rank and classical baselines
+                    printf("Speedup vs sequential Strassen: %.2fx\n", verify_time / wall_time);
+                } else {
+                    printf("WARNING: Verification time invalid.\n");
+                }
+            } else if (verify_mode == VERIFY_PREPARED) {
+                verifyPrepared(A, B, C, n);
+            } else if (verify_mode == VERIFY_FREIVALDS) {
+                printf("\nVerifying result with Freivalds' check (%d random vectors)...\n", FREIVALDS_TRIALS);
+                double verify_start = MPI_Wtime();
+                int passed = verifyFreivalds(A, B, C, n, FREIVALDS_TRIALS, 789);
+                printf("Freivalds check time: %.6f seconds\n", MPI_Wtime() - verify_start);
+                if (passed) {
+                    printf("Verification PASSED - Results match!\n");
+                } else {
+                    printf("Verification FAILED - Results do not match!\n");
+                }
+            }
         }
     }
-}
-
-double verifyResult(int** A, int** B, int** C, int n) {
-    printf("\nVerifying result with Strassen sequential multiplication...\n");
-    clock_t verify_start = clock();
-    int** C_verify = strassenMultiply(A, B, n);
-    clock_t verify_end = clock();
-
-    double verify_time = ((double)(verify_end - verify_start)) / CLOCKS_PER_SEC;
-    printf("Strassen sequential multiplication time: %.6f seconds\n", verify_time);
 
-    int correct = 1;
-    for (int i = 0; i < n && correct; i++) {
-        for (int j = 0; j < n && correct; j++) {
-            if (C[i][j] != C_verify[i][j]) {
-                correct = 0;
-                printf("Mismatch at [%d][%d]: Strassen MPI=%d, Strassen Seq=%d\n",
-                        i, j, C[i][j], C_verify[i][j]);
-                break;
+    if (!bench && verify_mode == VERIFY_EXACT) {
+        if (rank == 0) {
+            printf("\nVerifying every entry, rows distributed over %d processes...\n", num_procs);
+        }
+        double verify_start = MPI_Wtime();
+        long long mismatches = verifyExactDistributed(A, B, C, n, rank, num_procs);
+        if (rank == 0) {
+            printf("Exact check time: %.6f seconds\n", MPI_Wtime() - verify_start);
+            if (mismatches == 0) {
+                printf("Verification PASSED - Results match!\n");
+            } else {
+                printf("Verification FAILED - %lld entries do not match!\n", mismatches);
             }
         }
     }
 
-    if (correct) {
-        printf("Verification PASSED - Results match!\n");
-    } else {
-        printf("Verification FAILED - Results do not match!\n");
+    if (rank == 0 && !bench) {
+        freeMatrix(A, n);
+        freeMatrix(B, n);
+        freeMatrix(C, n);
     }
 
-    freeMatrix(C_verify, n);
+    if (profile_path) {
+        profileReport(profile_path, rank, num_procs);
+    }
+    if (trace_path) {
+        traceWrite(trace_path, rank, num_procs);
+    }
 
-    return verify_time;
+    windowDetach();
+    faultFinalize();
+    MPI_Finalize();
+    return 0;
 }
+
@@ -1,30 +1,63 @@
 #include "matrix_utils.h"
+#include "modular.h"
+#include "mixed_precision.h"
+#include "alloc.h"
+#include "fault.h"
+#include <stdint.h>
+#include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-int** initializeMatrix(int n) {
-    int** matrix = (int**)malloc(n * sizeof(int*));
+// Elements per 16-byte non-temporal store
+#define STREAM_LANES ((int)(16 / sizeof(elem_t)))
+
+
+// One contiguous block of elements (alloc.h) with row pointers into it
+static elem_t** newMatrix(int n, int zeroed) {
+    elem_t** matrix = (elem_t**)malloc((n > 0 ? n : 1) * sizeof(elem_t*));
+    elem_t* data = allocElements((size_t)n * n, zeroed);
     for (int i = 0; i < n; i++) {
-        matrix[i] = (int*)calloc(n, sizeof(int));
+        matrix[i] = data + (size_t)i * n;
+    }
+    if (n == 0) {
+        matrix[0] = data;
     }
     return matrix;
 }
 
 
-void freeMatrix(int** matrix, int n) {
+elem_t** initializeMatrix(int n) {
+    return newMatrix(n, 1);
+}
+
+
+elem_t** allocateMatrix(int n) {
+    return newMatrix(n, 0);
+}
+
+
+elem_t** duplicateMatrix(elem_t** source, int n) {
+    elem_t** matrix = allocateMatrix(n);
+    copyMatrix(source, matrix, n);
+    return matrix;
+}
+
+
+void freeMatrix(elem_t** matrix, int n) {
     if (matrix) {
-        for (int i = 0; i < n; i++) {
-            free(matrix[i]);
-        }
+        freeElements(matrix[0], (size_t)n * n);
         free(matrix);
     }
 }
 
 
-void printMatrix(int** matrix, int n, const char* name) {
+void printMatrix(elem_t** matrix, int n, const char* name) {
     printf("\nMatrix %s (%dx%d):\n", name, n, n);
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
-            printf("%4d ", matrix[i][j]);
+            printf("%4" ELEM_FMT " ", matrix[i][j]);
         }
         printf("\n");
     }
@@ -32,8 +65,102 @@ void printMatrix(int** matrix, int n, const char* name) {
 }
 
 
-int** addMatrices(int** A, int** B, int n) {
-    int** result = initializeMatrix(n);
+static int streamed(int n) {
+    return (size_t)n * n * sizeof(elem_t) >= STREAM_STORE_MIN_BYTES;
+}
+
+
+// s + sign * x, kept in [0, p) under --mod
+static inline elem_t addTerm(elem_t s, elem_t x, int sign) {
+    s = sign > 0 ? s + x : s - x;
+#if !ELEM_IS_FLOAT
+    elem_t p = strassen_modulus;
+    if (p) {
+        s = s >= p ? s - p : (s < 0 ? s + p : s);
+    }
+#endif
+    return s;
+}
+
+
+// dst = signs[0] * terms[0] + ... over n elements, added left to right like
+// chained addMatrices/subtractMatrices. With stream set, each 16 bytes are
+// formed in registers and written with one non-temporal store where SSE2
+// has them; the ends that do not fill an aligned 16 bytes use ordinary
+// stores. Finish a streamed pass with streamFence().
+static void sumRow(elem_t* dst, elem_t* const* terms, const int* signs, int count, int n, int stream) {
+    int j = 0;
+#if defined(__SSE2__)
+    if (stream) {
+        for (; j < n && ((uintptr_t)(dst + j) & 15) != 0; j++) {
+            elem_t s = 0;
+            for (int t = 0; t < count; t++) {
+                s = addTerm(s, terms[t][j], signs[t]);
+            }
+            dst[j] = s;
+        }
+        for (; j + STREAM_LANES <= n; j += STREAM_LANES) {
+            elem_t lane[STREAM_LANES] = { 0 };
+            for (int t = 0; t < count; t++) {
+                const elem_t* x = terms[t] + j;
+                if (strassen_modulus) {
+                    for (int l = 0; l < STREAM_LANES; l++) {
+                        lane[l] = addTerm(lane[l], x[l], signs[t]);
+                    }
+                } else if (signs[t] > 0) {
+                    for (int l = 0; l < STREAM_LANES; l++) {
+                        lane[l] += x[l];
+                    }
+                } else {
+                    for (int l = 0; l < STREAM_LANES; l++) {
+                        lane[l] -= x[l];
+                    }
+                }
+            }
+            _mm_stream_si128((__m128i*)(dst + j), _mm_loadu_si128((const __m128i*)lane));
+        }
+    }
+#else
+    (void)stream;
+#endif
+    // One pass per term over the rest of the row, which stays in cache
+    for (int t = 0; t < count; t++) {
+        const elem_t* x = terms[t];
+        if (strassen_modulus) {
+            for (int i = j; i < n; i++) {
+                dst[i] = addTerm(t == 0 ? 0 : dst[i], x[i], signs[t]);
+            }
+        } else if (t == 0) {
+            for (int i = j; i < n; i++) {
+                dst[i] = signs[t] > 0 ? x[i] : -x[i];
+            }
+        } else if (signs[t] > 0) {
+            for (int i = j; i < n; i++) {
+                dst[i] += x[i];
+            }
+        } else {
+            for (int i = j; i < n; i++) {
+                dst[i] -= x[i];
+            }
+        }
+    }
+}
+
+
+// Order the streamed stores before anything that follows, as they are
+// weakly ordered
+static void streamFence(void) {
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+
+
+elem_t** addMatrices(elem_t** A, elem_t** B, int n) {
+    if (strassen_modulus) {
+        return modAddMatrices(A, B, n);
+    }
+    elem_t** result = allocateMatrix(n);
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
             result[i][j] = A[i][j] + B[i][j];
@@ -43,8 +170,11 @@ int** addMatrices(int** A, int** B, int n) {
 }
 
 
-int** subtractMatrices(int** A, int** B, int n) {
-    int** result = initializeMatrix(n);
+elem_t** subtractMatrices(elem_t** A, elem_t** B, int n) {
+    if (strassen_modulus) {
+        return modSubtractMatrices(A, B, n);
+    }
+    elem_t** result = allocateMatrix(n);
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
             result[i][j] = A[i][j] - B[i][j];
@@ -53,8 +183,38 @@ int** subtractMatrices(int** A, int** B, int n) {
     return result;
 }
 
+
+// Each quadrant of C is summed from its products a row at a time and
+// written once, straight into C
+void assembleProducts(elem_t** C, elem_t** P[7], int k) {
+    int stream = streamed(2 * k);
+    for (int q = 0; q < 4; q++) {
+        int row = (q / 2) * k;
+        int col = (q % 2) * k;
+        int count = 0;
+        int signs[7];
+        int products[7];
+        for (int i = 0; i < 7; i++) {
+            if (strassenProductSigns[i][q] != 0) {
+                products[count] = i;
+                signs[count++] = strassenProductSigns[i][q];
+            }
+        }
+        for (int r = 0; r < k; r++) {
+            elem_t* terms[7];
+            for (int t = 0; t < count; t++) {
+                terms[t] = P[products[t]][r];
+            }
+            sumRow(C[row + r] + col, terms, signs, count, k, stream);
+        }
+    }
+    if (stream) {
+        streamFence();
+    }
+}
+
 // Split a matrix into 4 quadrants
-void splitMatrix(int** parent, int** A11, int** A12, int** A21, int** A22, int k) {
+void splitMatrix(elem_t** parent, elem_t** A11, elem_t** A12, elem_t** A21, elem_t** A22, int k) {
     for (int i = 0; i < k; i++) {
         for (int j = 0; j < k; j++) {
             A11[i][j] = parent[i][j];              // Top-left
@@ -66,7 +226,18 @@ void splitMatrix(int** parent, int** A11, int** A12, int** A21, int** A22, int k
 }
 
 // Combine 4 quadrants into a single matrix
-void combineBlocks(int** C, int** C11, int** C12, int** C21, int** C22, int k) {
+void combineBlocks(elem_t** C, elem_t** C11, elem_t** C12, elem_t** C21, elem_t** C22, int k) {
+    if (streamed(2 * k)) {
+        const int plus = 1;
+        for (int i = 0; i < k; i++) {
+            sumRow(C[i], &C11[i], &plus, 1, k, 1);
+            sumRow(C[i] + k, &C12[i], &plus, 1, k, 1);
+            sumRow(C[i + k], &C21[i], &plus, 1, k, 1);
+            sumRow(C[i + k] + k, &C22[i], &plus, 1, k, 1);
+        }
+        streamFence();
+        return;
+    }
     for (int i = 0; i < k; i++) {
         for (int j = 0; j < k; j++) {
             C[i][j] = C11[i][j];              // Top-left
@@ -78,8 +249,8 @@ void combineBlocks(int** C, int** C11, int** C12, int** C21, int** C22, int k) {
 }
 
 
-int* flattenMatrix(int** matrix, int n) {
-    int* flat = (int*)malloc(n * n * sizeof(int));
+elem_t* flattenMatrix(elem_t** matrix, int n) {
+    elem_t* flat = (elem_t*)malloc(n * n * sizeof(elem_t));
     int index = 0;
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
@@ -90,8 +261,8 @@ int* flattenMatrix(int** matrix, int n) {
 }
 
 
-int** unflattenMatrix(int* flat, int n) {
-    int** matrix = initializeMatrix(n);
+elem_t** unflattenMatrix(elem_t* flat, int n) {
+    elem_t** matrix = allocateMatrix(n);
     int index = 0;
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
@@ -102,7 +273,54 @@ int** unflattenMatrix(int* flat, int n) {
 }
 
 
-void copyMatrix(int** source, int** dest, int n) {
+void flattenMatrixInto(elem_t** matrix, elem_t* flat, int n) {
+    for (int i = 0; i < n; i++) {
+        memcpy(flat + (size_t)i * n, matrix[i], n * sizeof(elem_t));
+    }
+}
+
+
+const int strassenLeftTransform[7][3] = {
+    {0, 3, 1},   // P1: A11 + A22
+    {2, 3, 1},   // P2: A21 + A22
+    {0, 0, 0},   // P3: A11
+    {3, 0, 0},   // P4: A22
+    {0, 1, 1},   // P5: A11 + A12
+    {2, 0, -1},  // P6: A21 - A11
+    {1, 3, -1}   // P7: A12 - A22
+};
+
+const int strassenRightTransform[7][3] = {
+    {0, 3, 1},   // P1: B11 + B22
+    {0, 0, 0},   // P2: B11
+    {1, 3, -1},  // P3: B12 - B22
+    {2, 0, -1},  // P4: B21 - B11
+    {3, 0, 0},   // P5: B22
+    {0, 1, 1},   // P6: B11 + B12
+    {2, 3, 1}    // P7: B21 + B22
+};
+
+const int strassenProductSigns[7][4] = {
+    {  1, 0, 0,  1 },   // P1: C11, C22
+    {  0, 0, 1, -1 },   // P2: C21, -C22
+    {  0, 1, 0,  1 },   // P3: C12, C22
+    {  1, 0, 1,  0 },   // P4: C11, C21
+    { -1, 1, 0,  0 },   // P5: -C11, C12
+    {  0, 0, 0,  1 },   // P6: C22
+    {  1, 0, 0,  0 }    // P7: C11
+};
+
+
+elem_t** wrapFlatMatrix(elem_t* flat, int n) {
+    elem_t** matrix = (elem_t**)malloc(n * sizeof(elem_t*));
+    for (int i = 0; i < n; i++) {
+        matrix[i] = flat + (size_t)i * n;
+    }
+    return matrix;
+}
+
+
+void copyMatrix(elem_t** source, elem_t** dest, int n) {
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < n; j++) {
             dest[i][j] = source[i][j];
@@ -115,118 +333,161 @@ int isPowerOfTwo(int n) {
     return n > 0 && (n & (n - 1)) == 0;
 }
 
-// Sequential Strassen multiplication (for local computation)
-int** strassenMultiply(int** A, int** B, int n) {
-    if (n == 1) {
-        int** C = initializeMatrix(1);
-        C[0][0] = A[0][0] * B[0][0];
-        return C;
+
+elem_t maxAbsElement(elem_t** matrix, int n) {
+    elem_t max = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            elem_t v = matrix[i][j] < 0 ? -matrix[i][j] : matrix[i][j];
+            if (v > max) {
+                max = v;
+            }
+        }
     }
+    return max;
+}
+
+
+double strassenMagnitudeBound(int n, int cutoff, double max_a, double max_b) {
+    if (n <= cutoff || n == 1) {
+        // Partial sums of a leaf dot product
+        return n * max_a * max_b;
+    }
+    // Operand sums double the entry bound; each product is then bounded by
+    // (n/2) * 2a * 2b and the C quadrants add up to four of them
+    double inner = strassenMagnitudeBound(n / 2, cutoff, 2 * max_a, 2 * max_b);
+    double combined = 4.0 * (n / 2) * (2 * max_a) * (2 * max_b);
+    return inner > combined ? inner : combined;
+}
 
-    if (n <= 32) {
+// Sequential Strassen multiplication (for local computation)
+elem_t** strassenMultiply(elem_t** A, elem_t** B, int n) {
+    // Includes the 1x1 base case, reduced and dispatched like any leaf
+    if (n <= SEQUENTIAL_CUTOFF || n == 1) {
         return standardMultiply(A, B, n);
     }
 
     int k = n / 2;
 
 
-    int** A11 = initializeMatrix(k);
-    int** A12 = initializeMatrix(k);
-    int** A21 = initializeMatrix(k);
-    int** A22 = initializeMatrix(k);
+    elem_t** A11 = allocateMatrix(k);
+    elem_t** A12 = allocateMatrix(k);
+    elem_t** A21 = allocateMatrix(k);
+    elem_t** A22 = allocateMatrix(k);
 
-    int** B11 = initializeMatrix(k);
-    int** B12 = initializeMatrix(k);
-    int** B21 = initializeMatrix(k);
-    int** B22 = initializeMatrix(k);
+    elem_t** B11 = allocateMatrix(k);
+    elem_t** B12 = allocateMatrix(k);
+    elem_t** B21 = allocateMatrix(k);
+    elem_t** B22 = allocateMatrix(k);
 
     splitMatrix(A, A11, A12, A21, A22, k);
     splitMatrix(B, B11, B12, B21, B22, k);
 
-    int** temp1, **temp2;
+    elem_t** temp1, **temp2;
 
     // P1 = (A11 + A22) * (B11 + B22)
     temp1 = addMatrices(A11, A22, k);
     temp2 = addMatrices(B11, B22, k);
-    int** P1 = strassenMultiply(temp1, temp2, k);
+    elem_t** P1 = strassenMultiply(temp1, temp2, k);
     freeMatrix(temp1, k);
     freeMatrix(temp2, k);
 
     // P2 = (A21 + A22) * B11
     temp1 = addMatrices(A21, A22, k);
-    int** P2 = strassenMultiply(temp1, B11, k);
+    elem_t** P2 = strassenMultiply(temp1, B11, k);
     freeMatrix(temp1, k);
 
     // P3 = A11 * (B12 - B22)
     temp1 = subtractMatrices(B12, B22, k);
-    int** P3 = strassenMultiply(A11, temp1, k);
+    elem_t** P3 = strassenMultiply(A11, temp1, k);
     freeMatrix(temp1, k);
 
     // P4 = A22 * (B21 - B11)
     temp1 = subtractMatrices(B21, B11, k);
-    int** P4 = strassenMultiply(A22, temp1, k);
+    elem_t** P4 = strassenMultiply(A22, temp1, k);
     freeMatrix(temp1, k);
 
     // P5 = (A11 + A12) * B22
     temp1 = addMatrices(A11, A12, k);
-    int** P5 = strassenMultiply(temp1, B22, k);
+    elem_t** P5 = strassenMultiply(temp1, B22, k);
     freeMatrix(temp1, k);
 
     // P6 = (A21 - A11) * (B11 + B12)
     temp1 = subtractMatrices(A21, A11, k);
     temp2 = addMatrices(B11, B12, k);
-    int** P6 = strassenMultiply(temp1, temp2, k);
+    elem_t** P6 = strassenMultiply(temp1, temp2, k);
     freeMatrix(temp1, k);
     freeMatrix(temp2, k);
 
     // P7 = (A12 - A22) * (B21 + B22)
     temp1 = subtractMatrices(A12, A22, k);
     temp2 = addMatrices(B21, B22, k);
-    int** P7 = strassenMultiply(temp1, temp2, k);
-    freeMatrix(temp1, k);
-    freeMatrix(temp2, k);
-
-    // Calculate result quadrants
-    // C11 = P1 + P4 - P5 + P7
-    temp1 = addMatrices(P1, P4, k);
-    temp2 = subtractMatrices(temp1, P5, k);
-    int** C11 = addMatrices(temp2, P7, k);
-    freeMatrix(temp1, k);
-    freeMatrix(temp2, k);
-
-    // C12 = P3 + P5
-    int** C12 = addMatrices(P3, P5, k);
-
-    // C21 = P2 + P4
-    int** C21 = addMatrices(P2, P4, k);
-
-    // C22 = P1 - P2 + P3 + P6
-    temp1 = subtractMatrices(P1, P2, k);
-    temp2 = addMatrices(temp1, P3, k);
-    int** C22 = addMatrices(temp2, P6, k);
+    elem_t** P7 = strassenMultiply(temp1, temp2, k);
     freeMatrix(temp1, k);
     freeMatrix(temp2, k);
 
-    // Combine result
-    int** C = initializeMatrix(n);
-    combineBlocks(C, C11, C12, C21, C22, k);
+    // Form the result quadrants in place:
+    // C11 = P1 + P4 - P5 + P7, C12 = P3 + P5, C21 = P2 + P4, C22 = P1 - P2 + P3 + P6
+    elem_t** C = allocateMatrix(n);
+    elem_t** P[7] = { P1, P2, P3, P4, P5, P6, P7 };
+    assembleProducts(C, P, k);
 
     freeMatrix(A11, k); freeMatrix(A12, k); freeMatrix(A21, k); freeMatrix(A22, k);
     freeMatrix(B11, k); freeMatrix(B12, k); freeMatrix(B21, k); freeMatrix(B22, k);
     freeMatrix(P1, k); freeMatrix(P2, k); freeMatrix(P3, k); freeMatrix(P4, k);
     freeMatrix(P5, k); freeMatrix(P6, k); freeMatrix(P7, k);
-    freeMatrix(C11, k); freeMatrix(C12, k); freeMatrix(C21, k); freeMatrix(C22, k);
 
     return C;
 }
 
 
-int** standardMultiply(int** A, int** B, int n) {
-    int** C = initializeMatrix(n);
+elem_t** standardMultiply(elem_t** A, elem_t** B, int n) {
+    if (strassen_modulus) {
+        return modStandardMultiply(A, B, n);
+    }
+    if (leaf_precision == LEAF_BF16) {
+        return bf16Multiply(A, B, n);
+    }
+    elem_t** C = allocateMatrix(n);
     for (int i = 0; i < n; i++) {
+        // A leaf under a large cutoff can outlast a quarter of the timeout
+        heartbeatPoll();
         for (int j = 0; j < n; j++) {
+            acc_t sum = 0;
             for (int k = 0; k < n; k++) {
-                C[i][j] += A[i][k] * B[k][j];
+                sum += (acc_t)A[i][k] * B[k][j];
+            }
+            C[i][j] = (elem_t)sum;
+        }
+    }
+    return C;
+}
+
+// Cache-blocked classical multiplication: i-k-j order inside square tiles so
+// the innermost loop streams contiguous rows of B and C. The first term of
+// every C[i][j] (k = 0) is written rather than added, so C needs no zeroing.
+elem_t** blockedMultiply(elem_t** A, elem_t** B, int n) {
+    elem_t** C = allocateMatrix(n);
+    int bs = n < GEMM_BLOCK_SIZE ? n : GEMM_BLOCK_SIZE;
+    for (int ii = 0; ii < n; ii += bs) {
+        for (int kk = 0; kk < n; kk += bs) {
+            for (int jj = 0; jj < n; jj += bs) {
+                for (int i = ii; i < ii + bs; i++) {
+                    elem_t* Crow = C[i];
+                    for (int k = kk; k < kk + bs; k++) {
+                        elem_t a = A[i][k];
+                        elem_t* Brow = B[k];
+                        if (k == 0) {
+                            for (int j = jj; j < jj + bs; j++) {
+                                Crow[j] = a * Brow[j];
+                            }
+                        } else {
+                            for (int j = jj; j < jj + bs; j++) {
+                                Crow[j] += a * Brow[j];
+                            }
+                        }
+                    }
+                }
             }
         }
     }
@@ -5,30 +5,129 @@
 #include <stdlib.h>
 #include <mpi.h>
 
-// MPI communication tags
-#define TAG_WORK 100
+// MPI communication tags. Messages within an assignment use makeTag (comm.h).
+#define TAG_WORK 100      // Work header and termination, received from any source
+#define TAG_HEARTBEAT 102 // Busy child to parent, when a task timeout is set (fault.h)
 
-// Matrix operations
-int** initializeMatrix(int n);
-void copyMatrix(int** source, int** dest, int n);
-void freeMatrix(int** matrix, int n);
-void printMatrix(int** matrix, int n, const char* name);
-int** addMatrices(int** A, int** B, int n);
-int** subtractMatrices(int** A, int** B, int n);
+// Element type of every matrix. The default stores and accumulates 32-bit
+// ints; main refuses a run unless strassenMagnitudeBound proves that no
+// intermediate overflows them. Building with -DSTRASSEN_INT64 (make ELEM=int64) widens storage and
+// accumulation to 64 bits, so the operand sums that grow by one bit per
+// Strassen level cannot overflow for realistic inputs. -DSTRASSEN_DOUBLE
+// (make ELEM=double) switches to IEEE doubles, where results carry rounding
+// error that grows with recursion depth (see accuracy.h). -DSTRASSEN_FLOAT
+// (make ELEM=float) stores fp32, halving memory and message sizes, and
+// accumulates the leaf dot products in fp64.
+// ELEM_FMT is the printf conversion without the '%', e.g. "%4" ELEM_FMT.
+// acc_t is the accumulator of the leaf kernel's dot products.
+// uelem_t is the unsigned type the integer builds use for wraparound arithmetic.
+// ELEM_EPSILON is the unit roundoff u of floating-point builds.
+#if defined(STRASSEN_FLOAT)
+typedef float elem_t;
+typedef double acc_t;
+#define MPI_ELEM MPI_FLOAT
+#define ELEM_FMT "g"
+#define ELEM_NAME "float"
+#define ELEM_MAX 3.4028234663852886e38
+#define ELEM_IS_FLOAT 1
+#define ELEM_EPSILON 5.9604644775390625e-08
+#elif defined(STRASSEN_DOUBLE)
+typedef double elem_t;
+typedef double acc_t;
+#define MPI_ELEM MPI_DOUBLE
+#define ELEM_FMT "g"
+#define ELEM_NAME "double"
+#define ELEM_MAX 1.7976931348623157e308
+#define ELEM_IS_FLOAT 1
+#define ELEM_EPSILON 1.1102230246251565e-16
+#elif defined(STRASSEN_INT64)
+typedef long long elem_t;
+typedef unsigned long long uelem_t;
+typedef long long acc_t;
+#define MPI_ELEM MPI_LONG_LONG
+#define ELEM_FMT "lld"
+#define ELEM_NAME "int64"
+#define ELEM_MAX 9223372036854775807.0
+#define ELEM_IS_FLOAT 0
+#else
+typedef int elem_t;
+typedef unsigned int uelem_t;
+typedef int acc_t;
+#define MPI_ELEM MPI_INT
+#define ELEM_FMT "d"
+#define ELEM_NAME "int32"
+#define ELEM_MAX 2147483647.0
+#define ELEM_IS_FLOAT 0
+#endif
+
+// Below this size the sequential Strassen falls back to standard multiplication
+#define SEQUENTIAL_CUTOFF 32
+
+// Tile size of the cache-blocked classical multiplication
+#define GEMM_BLOCK_SIZE 64
+
+// A result C at least this large is written with non-temporal stores: this
+// level never reads it back, so it bypasses the cache instead of evicting
+// the working set and skips the read-for-ownership of every line. Sums and
+// other temporaries that are read back at once keep ordinary stores.
+#define STREAM_STORE_MIN_BYTES (16 << 20)
+
+// Matrix allocation, by what the caller does with the elements:
+// - initializeMatrix: zeroed, for a result that is accumulated into (+=)
+//   from its first use. No in-tree kernel needs this: blockedMultiply, the
+//   task graph (task_dag.c) and the Morton engine write their first
+//   contribution instead, so their accumulators skip the zeroing pass.
+// - allocateMatrix: unset, for a result whose every element is written
+//   before it is read: sums, split quadrants, kernel and leaf outputs, C as
+//   formed by assembleProducts/combineBlocks, and receive buffers.
+// - duplicateMatrix: overwritten from a source, allocateMatrix + copyMatrix.
+elem_t** initializeMatrix(int n);
+elem_t** allocateMatrix(int n);
+elem_t** duplicateMatrix(elem_t** source, int n);
+void copyMatrix(elem_t** source, elem_t** dest, int n);
+void freeMatrix(elem_t** matrix, int n);
+void printMatrix(elem_t** matrix, int n, const char* name);
+elem_t** addMatrices(elem_t** A, elem_t** B, int n);
+elem_t** subtractMatrices(elem_t** A, elem_t** B, int n);
 
 // Matrix splitting and combining for Strassen
-void splitMatrix(int** parent, int** A11, int** A12, int** A21, int** A22, int k);
-void combineBlocks(int** C, int** C11, int** C12, int** C21, int** C22, int k);
+void splitMatrix(elem_t** parent, elem_t** A11, elem_t** A12, elem_t** A21, elem_t** A22, int k);
+void combineBlocks(elem_t** C, elem_t** C11, elem_t** C12, elem_t** C21, elem_t** C22, int k);
+
+// C11..C22 = Strassen's sums of the products P1..P7 (P[0..6]), each written
+// straight into its quadrant of the size-2k matrix C, without temporaries
+void assembleProducts(elem_t** C, elem_t** P[7], int k);
 
 // Matrix serialization for MPI communication
-int* flattenMatrix(int** matrix, int n);
-int** unflattenMatrix(int* flat, int n);
+elem_t* flattenMatrix(elem_t** matrix, int n);
+elem_t** unflattenMatrix(elem_t* flat, int n);
+void flattenMatrixInto(elem_t** matrix, elem_t* flat, int n);
+
+// Row pointers into existing flat storage, without copying. Release with
+// free(), not freeMatrix(); the storage stays with its owner.
+elem_t** wrapFlatMatrix(elem_t* flat, int n);
+
+// Operand transforms of Strassen's P1..P7 as {first quadrant, second
+// quadrant, op}, quadrants numbered 0 = X11, 1 = X12, 2 = X21, 3 = X22 and op
+// +1 (first + second), -1 (first - second) or 0 (first alone)
+extern const int strassenLeftTransform[7][3];
+extern const int strassenRightTransform[7][3];
+
+// Sign (+1, -1 or 0) with which P1..P7 enter C11, C12, C21 and C22
+extern const int strassenProductSigns[7][4];
 
 // Sequential Strassen and Standard multiplication
-int** strassenMultiply(int** A, int** B, int n);
-int** standardMultiply(int** A, int** B, int n);
+elem_t** strassenMultiply(elem_t** A, elem_t** B, int n);
+elem_t** standardMultiply(elem_t** A, elem_t** B, int n);
+elem_t** blockedMultiply(elem_t** A, elem_t** B, int n);
 
 // Utility
 int isPowerOfTwo(int n);
+elem_t maxAbsElement(elem_t** matrix, int n);
+
+// Largest magnitude any intermediate value can reach when Strassen with the
+// given cutoff multiplies matrices whose entries are bounded by max_a, max_b.
+// Compare against ELEM_MAX to prove that the element type cannot overflow.
+double strassenMagnitudeBound(int n, int cutoff, double max_a, double max_b);
 
 #endif // MATRIX_UTILS_H
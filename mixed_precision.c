@@ -0,0 +1,81 @@
+#include "mixed_precision.h"
+#include "fault.h"
+
+#if defined(__AVX512BF16__)
+#include <immintrin.h>
+#endif
+
+int leaf_precision = LEAF_NATIVE;
+
+
+int setLeafPrecision(int precision) {
+    if (precision == LEAF_BF16 && !ELEM_IS_FLOAT) {
+        return 0;
+    }
+    if (precision != LEAF_NATIVE && precision != LEAF_BF16) {
+        return 0;
+    }
+    leaf_precision = precision;
+    return 1;
+}
+
+
+const char* leafPrecisionName(int precision) {
+#if defined(__AVX512BF16__)
+    return precision == LEAF_BF16 ? "bf16 (AVX-512 BF16)" : "native";
+#else
+    return precision == LEAF_BF16 ? "bf16 (scalar)" : "native";
+#endif
+}
+
+
+// Round the rows of M to bf16 into a contiguous n x n block. With transpose
+// set the block holds M's columns, so every dot product reads two rows.
+static bf16_t* packBf16(elem_t** M, int n, int transpose) {
+    bf16_t* packed = (bf16_t*)malloc((size_t)n * n * sizeof(bf16_t));
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            float v = (float)(transpose ? M[j][i] : M[i][j]);
+            packed[(size_t)i * n + j] = floatToBf16(v);
+        }
+    }
+    return packed;
+}
+
+
+static float dotBf16(const bf16_t* x, const bf16_t* y, int n) {
+    int k = 0;
+    float sum = 0.0f;
+#if defined(__AVX512BF16__)
+    // Each instruction multiplies 32 bf16 pairs and adds them pairwise into
+    // 16 fp32 lanes
+    __m512 acc = _mm512_setzero_ps();
+    for (; k + 32 <= n; k += 32) {
+        __m512bh vx = (__m512bh)_mm512_loadu_si512((const void*)(x + k));
+        __m512bh vy = (__m512bh)_mm512_loadu_si512((const void*)(y + k));
+        acc = _mm512_dpbf16_ps(acc, vx, vy);
+    }
+    sum = _mm512_reduce_add_ps(acc);
+#endif
+    for (; k < n; k++) {
+        sum += bf16ToFloat(x[k]) * bf16ToFloat(y[k]);
+    }
+    return sum;
+}
+
+
+elem_t** bf16Multiply(elem_t** A, elem_t** B, int n) {
+    bf16_t* a = packBf16(A, n, 0);
+    bf16_t* bt = packBf16(B, n, 1);
+    elem_t** C = allocateMatrix(n);
+    for (int i = 0; i < n; i++) {
+        heartbeatPoll();
+        const bf16_t* row = a + (size_t)i * n;
+        for (int j = 0; j < n; j++) {
+            C[i][j] = (elem_t)dotBf16(row, bt + (size_t)j * n, n);
+        }
+    }
+    free(a);
+    free(bt);
+    return C;
+}
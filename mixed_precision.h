@@ -0,0 +1,46 @@
+#ifndef MIXED_PRECISION_H
+#define MIXED_PRECISION_H
+
+#include "matrix_utils.h"
+
+// Precision of the leaf kernel, where almost all of the flops happen.
+// LEAF_NATIVE multiplies elem_t values and accumulates in acc_t (for the
+// float build: fp32 products accumulated in fp64). LEAF_BF16 rounds both
+// operands to bfloat16 and accumulates in fp32. With AVX-512 BF16 dot
+// products (make NATIVE=1 on a CPU that has them) the kernel streams half
+// the bytes; the scalar loop used otherwise is slower than LEAF_NATIVE and
+// only emulates bf16 accuracy. Storage and messages are unaffected; see
+// PAYLOAD_BF16 (comm.h) for bf16 operands on the wire.
+#define LEAF_NATIVE 0
+#define LEAF_BF16   1
+
+// Unit roundoff of bfloat16 (8-bit significand)
+#define BF16_EPSILON 0.00390625
+
+extern int leaf_precision;
+
+// Select the leaf kernel. Must be identical on all ranks; LEAF_BF16 needs a
+// floating-point element type. Returns 0 if the precision is not available.
+int setLeafPrecision(int precision);
+const char* leafPrecisionName(int precision);
+
+typedef unsigned short bf16_t;
+
+// Round to nearest even; NaNs stay NaNs
+static inline bf16_t floatToBf16(float x) {
+    union { float f; unsigned int u; } v = { x };
+    if ((v.u & 0x7FFFFFFFu) > 0x7F800000u) {
+        return (bf16_t)((v.u >> 16) | 0x40);
+    }
+    return (bf16_t)((v.u + 0x7FFFu + ((v.u >> 16) & 1)) >> 16);
+}
+
+static inline float bf16ToFloat(bf16_t x) {
+    union { unsigned int u; float f; } v = { (unsigned int)x << 16 };
+    return v.f;
+}
+
+// C = A * B with bf16 operands and fp32 accumulation
+elem_t** bf16Multiply(elem_t** A, elem_t** B, int n);
+
+#endif // MIXED_PRECISION_H
@@ -0,0 +1,222 @@
+#include "modular.h"
+#include "strassen_mpi.h"
+#include "fault.h"
+#include <math.h>
+
+elem_t strassen_modulus = 0;
+
+static const elem_t crtPrimes[CRT_MAX_PRIMES] = {
+    1073741789, 1073741783, 1073741741, 1073741723,
+    1073741719, 1073741717, 1073741689, 1073741671
+};
+
+
+int setModulus(elem_t p) {
+#if ELEM_IS_FLOAT
+    // Residues need exact integer elements
+    if (p != 0) {
+        return 0;
+    }
+#endif
+    if (p < 0 || p == 1 || p > MAX_MODULUS) {
+        return 0;
+    }
+    strassen_modulus = p;
+    return 1;
+}
+
+
+void reduceMatrix(elem_t** M, int n, elem_t p) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+#if ELEM_IS_FLOAT
+            elem_t v = fmod(M[i][j], p);
+#else
+            elem_t v = M[i][j] % p;
+#endif
+            M[i][j] = v < 0 ? v + p : v;
+        }
+    }
+}
+
+
+elem_t** modAddMatrices(elem_t** A, elem_t** B, int n) {
+    elem_t p = strassen_modulus;
+    elem_t** result = allocateMatrix(n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            elem_t s = A[i][j] + B[i][j];
+            result[i][j] = s >= p ? s - p : s;
+        }
+    }
+    return result;
+}
+
+
+elem_t** modSubtractMatrices(elem_t** A, elem_t** B, int n) {
+    elem_t p = strassen_modulus;
+    elem_t** result = allocateMatrix(n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            elem_t d = A[i][j] - B[i][j];
+            result[i][j] = d < 0 ? d + p : d;
+        }
+    }
+    return result;
+}
+
+
+elem_t** modStandardMultiply(elem_t** A, elem_t** B, int n) {
+    unsigned long long p = (unsigned long long)strassen_modulus;
+    unsigned long long max_term = (p - 1) * (p - 1);
+    // Terms that can be added to a reduced sum (< p) without overflow
+    int run = max_term ? (int)(((~0ULL) - p) / max_term) : n;
+    if (run < 1 || run > n) {
+        run = n;
+    }
+
+    elem_t** C = allocateMatrix(n);
+    for (int i = 0; i < n; i++) {
+        heartbeatPoll();
+        for (int j = 0; j < n; j++) {
+            unsigned long long sum = 0;
+            for (int k0 = 0; k0 < n; k0 += run) {
+                int k_end = k0 + run < n ? k0 + run : n;
+                for (int k = k0; k < k_end; k++) {
+                    sum += (unsigned long long)A[i][k] * (unsigned long long)B[k][j];
+                }
+                sum %= p;
+            }
+            C[i][j] = (elem_t)sum;
+        }
+    }
+    return C;
+}
+
+
+static unsigned long long mulMod(unsigned long long a, unsigned long long b, unsigned long long p) {
+    // Operands are below 2^30, so the product fits in 64 bits
+    return (a * b) % p;
+}
+
+
+static unsigned long long inverseMod(unsigned long long a, unsigned long long p) {
+    // Fermat: a^(p-2) mod p for prime p
+    unsigned long long result = 1;
+    unsigned long long base = a % p;
+    unsigned long long e = p - 2;
+    while (e) {
+        if (e & 1) {
+            result = mulMod(result, base, p);
+        }
+        base = mulMod(base, base, p);
+        e >>= 1;
+    }
+    return result;
+}
+
+
+// Choose how many primes are needed so that their product exceeds four times
+// the largest possible |C| entry; the margin keeps the sign decision robust
+static int choosePrimeCount(elem_t** A, elem_t** B, int n) {
+    double bound = (double)n * (double)maxAbsElement(A, n) * (double)maxAbsElement(B, n);
+    double product = 1.0;
+    int count = 0;
+    while (count < CRT_MAX_PRIMES && product <= 4.0 * bound) {
+        product *= (double)crtPrimes[count++];
+    }
+    if (bound > ELEM_MAX) {
+        printf("WARNING: Product entries may reach %.3g, beyond %s; CRT results wrap\n", bound, ELEM_NAME);
+    }
+    return count > 0 ? count : 1;
+}
+
+
+elem_t** crtMultiply(elem_t** A, elem_t** B, int n, int num_primes, int rank, int num_procs) {
+    if (num_primes <= 0 || num_primes > CRT_MAX_PRIMES) {
+        num_primes = rank == 0 ? choosePrimeCount(A, B, n) : 0;
+        MPI_Bcast(&num_primes, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+
+    elem_t saved_modulus = strassen_modulus;
+    elem_t** residues[CRT_MAX_PRIMES];
+
+    for (int i = 0; i < num_primes; i++) {
+        elem_t p = crtPrimes[i];
+        elem_t** Ap = NULL;
+        elem_t** Bp = NULL;
+        if (rank == 0) {
+            Ap = duplicateMatrix(A, n);
+            Bp = duplicateMatrix(B, n);
+            reduceMatrix(Ap, n, p);
+            reduceMatrix(Bp, n, p);
+        }
+
+        setModulus(p);
+        residues[i] = runDistributedMultiply(Ap, Bp, n, rank, num_procs);
+
+        if (rank == 0) {
+            freeMatrix(Ap, n);
+            freeMatrix(Bp, n);
+        }
+    }
+    strassen_modulus = saved_modulus;
+
+    if (rank != 0) {
+        return NULL;
+    }
+
+    // inverse[j][i] = p_j^-1 mod p_i for Garner's algorithm
+    unsigned long long inverse[CRT_MAX_PRIMES][CRT_MAX_PRIMES];
+    for (int i = 0; i < num_primes; i++) {
+        for (int j = 0; j < i; j++) {
+            inverse[j][i] = inverseMod((unsigned long long)crtPrimes[j], (unsigned long long)crtPrimes[i]);
+        }
+    }
+
+    // Product of all primes modulo 2^64, used to map the upper half to negatives
+    unsigned long long modulus_product = 1;
+    for (int i = 0; i < num_primes; i++) {
+        modulus_product *= (unsigned long long)crtPrimes[i];
+    }
+
+    elem_t** C = allocateMatrix(n);
+    unsigned long long digits[CRT_MAX_PRIMES];
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < n; c++) {
+            // Mixed-radix digits: x = d0 + p0 * (d1 + p1 * (d2 + ...))
+            for (int i = 0; i < num_primes; i++) {
+                unsigned long long p = (unsigned long long)crtPrimes[i];
+                unsigned long long x = (unsigned long long)residues[i][r][c];
+                for (int j = 0; j < i; j++) {
+                    x = mulMod((x + p - digits[j] % p) % p, inverse[j][i], p);
+                }
+                digits[i] = x;
+            }
+
+            // x modulo 2^64, and x / (p0 * ... * pk-1) to decide the sign
+            unsigned long long value = 0;
+            unsigned long long weight = 1;
+            double fraction = 0.0;
+            double tail = 1.0;
+            for (int i = num_primes - 1; i >= 0; i--) {
+                tail *= (double)crtPrimes[i];
+                fraction += (double)digits[i] / tail;
+            }
+            for (int i = 0; i < num_primes; i++) {
+                value += digits[i] * weight;
+                weight *= (unsigned long long)crtPrimes[i];
+            }
+            if (fraction >= 0.5) {
+                value -= modulus_product;
+            }
+            C[r][c] = (elem_t)(long long)value;
+        }
+    }
+
+    for (int i = 0; i < num_primes; i++) {
+        freeMatrix(residues[i], n);
+    }
+    printf("CRT reconstruction from %d primes\n", num_primes);
+    return C;
+}
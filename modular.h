@@ -0,0 +1,40 @@
+#ifndef MODULAR_H
+#define MODULAR_H
+
+#include "matrix_utils.h"
+
+// Exact arithmetic over Z/pZ. While a modulus is set every matrix entry is
+// kept in [0, p): addMatrices/subtractMatrices correct their result with one
+// conditional add or subtract, and the leaf kernel accumulates unreduced
+// 64-bit products, reducing only when the next term could overflow.
+
+// Largest supported modulus: sums of two residues must fit in elem_t
+#define MAX_MODULUS (1 << 30)
+
+// Primes just below 2^30 used by the CRT mode
+#define CRT_MAX_PRIMES 8
+
+extern elem_t strassen_modulus;   // 0 when ordinary integer arithmetic is used
+
+// Select the modulus for all kernels (0 turns modular arithmetic off).
+// Must be identical on all ranks. Returns 0 if p is out of range.
+int setModulus(elem_t p);
+
+// Reduce every entry of a matrix into [0, p), in place
+void reduceMatrix(elem_t** M, int n, elem_t p);
+
+// Modular kernels behind addMatrices, subtractMatrices and standardMultiply
+elem_t** modAddMatrices(elem_t** A, elem_t** B, int n);
+elem_t** modSubtractMatrices(elem_t** A, elem_t** B, int n);
+elem_t** modStandardMultiply(elem_t** A, elem_t** B, int n);
+
+// Exact product through the Chinese remainder theorem: one distributed
+// multiplication modulo each of num_primes primes, reconstructed with
+// Garner's algorithm. num_primes = 0 picks the smallest count whose product
+// safely covers n * max|A| * max|B|. Intermediates never grow beyond p, so
+// the result is exact whenever the final product fits elem_t, even where
+// plain Strassen's intermediates would overflow. Must be called by all
+// ranks; returns C on rank 0 and NULL elsewhere.
+elem_t** crtMultiply(elem_t** A, elem_t** B, int n, int num_primes, int rank, int num_procs);
+
+#endif // MODULAR_H
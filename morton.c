@@ -0,0 +1,178 @@
+#include "morton.h"
+#include "modular.h"
+#include "mixed_precision.h"
+#include "fault.h"
+#include <string.h>
+
+int matrix_layout = LAYOUT_ROW_MAJOR;
+
+
+int mortonTile(int n, int cutoff) {
+    int tile = n;
+    while (tile > cutoff && tile > 1) {
+        tile /= 2;
+    }
+    return tile;
+}
+
+
+static void packBlock(elem_t** M, int row, int col, int n, int tile, elem_t* Z) {
+    if (n == tile) {
+        for (int i = 0; i < n; i++) {
+            memcpy(Z + (size_t)i * n, M[row + i] + col, n * sizeof(elem_t));
+        }
+        return;
+    }
+    int k = n / 2;
+    size_t kk = (size_t)k * k;
+    packBlock(M, row, col, k, tile, Z);
+    packBlock(M, row, col + k, k, tile, Z + kk);
+    packBlock(M, row + k, col, k, tile, Z + 2 * kk);
+    packBlock(M, row + k, col + k, k, tile, Z + 3 * kk);
+}
+
+
+static void unpackBlock(const elem_t* Z, int row, int col, int n, int tile, elem_t** M) {
+    if (n == tile) {
+        for (int i = 0; i < n; i++) {
+            memcpy(M[row + i] + col, Z + (size_t)i * n, n * sizeof(elem_t));
+        }
+        return;
+    }
+    int k = n / 2;
+    size_t kk = (size_t)k * k;
+    unpackBlock(Z, row, col, k, tile, M);
+    unpackBlock(Z + kk, row, col + k, k, tile, M);
+    unpackBlock(Z + 2 * kk, row + k, col, k, tile, M);
+    unpackBlock(Z + 3 * kk, row + k, col + k, k, tile, M);
+}
+
+
+elem_t* toMorton(elem_t** M, int n, int tile) {
+    elem_t* Z = (elem_t*)malloc((size_t)n * n * sizeof(elem_t));
+    packBlock(M, 0, 0, n, tile, Z);
+    return Z;
+}
+
+
+elem_t** fromMorton(const elem_t* Z, int n, int tile) {
+    elem_t** M = allocateMatrix(n);
+    unpackBlock(Z, 0, 0, n, tile, M);
+    return M;
+}
+
+
+// dst = x + sign * y over len contiguous elements, kept in [0, p) under --mod
+static void combineRange(elem_t* dst, const elem_t* x, const elem_t* y, size_t len, int sign) {
+#if !ELEM_IS_FLOAT
+    elem_t p = strassen_modulus;
+    if (p) {
+        for (size_t i = 0; i < len; i++) {
+            elem_t s = sign > 0 ? x[i] + y[i] : x[i] - y[i];
+            dst[i] = s >= p ? s - p : (s < 0 ? s + p : s);
+        }
+        return;
+    }
+#endif
+    if (sign > 0) {
+        for (size_t i = 0; i < len; i++) {
+            dst[i] = x[i] + y[i];
+        }
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            dst[i] = x[i] - y[i];
+        }
+    }
+}
+
+
+// Row-major tile product. The modular and bf16 kernels run on row pointers
+// wrapped around the tiles.
+static void multiplyTile(const elem_t* A, const elem_t* B, elem_t* C, int n) {
+    if (strassen_modulus || leaf_precision == LEAF_BF16) {
+        elem_t** a = wrapFlatMatrix((elem_t*)A, n);
+        elem_t** b = wrapFlatMatrix((elem_t*)B, n);
+        elem_t** c = standardMultiply(a, b, n);
+        flattenMatrixInto(c, C, n);
+        freeMatrix(c, n);
+        free(a);
+        free(b);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        const elem_t* a = A + (size_t)i * n;
+        for (int j = 0; j < n; j++) {
+            acc_t sum = 0;
+            for (int k = 0; k < n; k++) {
+                sum += (acc_t)a[k] * B[(size_t)k * n + j];
+            }
+            C[(size_t)i * n + j] = (elem_t)sum;
+        }
+    }
+}
+
+
+// Quadrant X_t[0] alone, or X_t[0] +/- X_t[1] formed in scratch
+static const elem_t* formOperand(const elem_t* X, const int t[3], size_t kk, elem_t* scratch) {
+    if (t[2] == 0) {
+        return X + t[0] * kk;
+    }
+    combineRange(scratch, X + t[0] * kk, X + t[1] * kk, kk, t[2]);
+    return scratch;
+}
+
+
+void mortonMultiply(const elem_t* A, const elem_t* B, elem_t* C, int n, int tile) {
+    // A child running a whole subtree here must keep its parent informed
+    heartbeatPoll();
+    if (n <= tile) {
+        multiplyTile(A, B, C, n);
+        return;
+    }
+
+    int k = n / 2;
+    size_t kk = (size_t)k * k;
+    elem_t* S = (elem_t*)malloc(kk * sizeof(elem_t));
+    elem_t* T = (elem_t*)malloc(kk * sizeof(elem_t));
+    elem_t* P = (elem_t*)malloc(kk * sizeof(elem_t));
+
+    // The first product entering each quadrant of C does so with a positive
+    // sign (P1, P3, P2 and P1), so it is copied in and the rest are added
+    int written[4] = { 0 };
+    for (int i = 0; i < 7; i++) {
+        const elem_t* left = formOperand(A, strassenLeftTransform[i], kk, S);
+        const elem_t* right = formOperand(B, strassenRightTransform[i], kk, T);
+        mortonMultiply(left, right, P, k, tile);
+        for (int q = 0; q < 4; q++) {
+            int sign = strassenProductSigns[i][q];
+            elem_t* Cq = C + q * kk;
+            if (sign == 0) {
+                continue;
+            }
+            if (written[q]) {
+                combineRange(Cq, Cq, P, kk, sign);
+            } else {
+                memcpy(Cq, P, kk * sizeof(elem_t));
+                written[q] = 1;
+            }
+        }
+    }
+
+    free(S);
+    free(T);
+    free(P);
+}
+
+
+elem_t** mortonStrassen(elem_t** A, elem_t** B, int n, int cutoff) {
+    int tile = mortonTile(n, cutoff);
+    elem_t* ZA = toMorton(A, n, tile);
+    elem_t* ZB = toMorton(B, n, tile);
+    elem_t* ZC = (elem_t*)malloc((size_t)n * n * sizeof(elem_t));
+    mortonMultiply(ZA, ZB, ZC, n, tile);
+    elem_t** C = fromMorton(ZC, n, tile);
+    free(ZA);
+    free(ZB);
+    free(ZC);
+    return C;
+}
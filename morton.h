@@ -0,0 +1,38 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+#include "matrix_utils.h"
+
+// Morton (Z-order) block layout. An n x n matrix is stored as its quadrants
+// X11, X12, X21, X22 one after another, each laid out the same way, down to
+// tiles of tile x tile elements stored row-major. Every Strassen quadrant at
+// every level is then one contiguous range: quadrant q of a size-n block at
+// offset o is at o + q * (n/2)^2. Splitting is pointer arithmetic, operand
+// sums and products stream through contiguous memory, and any subproblem is
+// a single range that could go out as one message.
+//
+// Conversion happens at the boundary (--layout morton): a rank's local
+// subtree converts A and B once, recurses entirely in Morton layout and
+// converts C back.
+
+#define LAYOUT_ROW_MAJOR 0
+#define LAYOUT_MORTON    1
+
+extern int matrix_layout;   // Set by --layout; row-major by default
+
+// Tile size where a recursion from n stops at cutoff: n halved until it is
+// at most cutoff. The layout and the recursion must agree on it.
+int mortonTile(int n, int cutoff);
+
+// Row pointers <-> Morton buffer of n * n elements (n / tile a power of two)
+elem_t* toMorton(elem_t** M, int n, int tile);
+elem_t** fromMorton(const elem_t* Z, int n, int tile);
+
+// C = A * B with all three in Morton layout; C is overwritten
+void mortonMultiply(const elem_t* A, const elem_t* B, elem_t* C, int n, int tile);
+
+// Strassen with leaves of at most cutoff, converting to and from Morton
+// layout at the boundary
+elem_t** mortonStrassen(elem_t** A, elem_t** B, int n, int cutoff);
+
+#endif // MORTON_H
@@ -0,0 +1,105 @@
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_FIELDS 3   // seconds, bytes, calls
+
+int profile_enabled = 0;
+
+static const char* phaseNames[NUM_PHASES] = {
+    "send", "recv", "split", "addsub", "leaf", "combine", "idle"
+};
+
+// Counters indexed by [level][phase][field], kept as doubles so the whole
+// table can be gathered with a single MPI call
+static double counters[PROFILE_MAX_LEVELS][NUM_PHASES][PROFILE_FIELDS];
+
+
+void profileEnable(void) {
+    profile_enabled = 1;
+    memset(counters, 0, sizeof(counters));
+}
+
+
+void profileRecord(ProfilePhase phase, int level, double start, long long bytes) {
+    if (level < 0) {
+        level = 0;
+    }
+    if (level >= PROFILE_MAX_LEVELS) {
+        level = PROFILE_MAX_LEVELS - 1;
+    }
+    double* entry = counters[level][phase];
+    entry[0] += MPI_Wtime() - start;
+    entry[1] += (double)bytes;
+    entry[2] += 1.0;
+}
+
+
+const char* profilePhaseName(int phase) {
+    return phaseNames[phase];
+}
+
+
+static int endsWith(const char* s, const char* suffix) {
+    size_t len = strlen(s);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(s + len - suffix_len, suffix) == 0;
+}
+
+
+void profileReport(const char* path, int rank, int num_procs) {
+    int count = PROFILE_MAX_LEVELS * NUM_PHASES * PROFILE_FIELDS;
+    double* all = NULL;
+    if (rank == 0) {
+        all = (double*)malloc((size_t)count * num_procs * sizeof(double));
+    }
+
+    MPI_Gather(counters, count, MPI_DOUBLE, all, count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (rank != 0) {
+        return;
+    }
+
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        printf("WARNING: Cannot write profile report to %s\n", path);
+        free(all);
+        return;
+    }
+
+    int json = endsWith(path, ".json");
+    int first = 1;
+    if (json) {
+        fprintf(out, "[\n");
+    } else {
+        fprintf(out, "rank,level,phase,seconds,bytes,calls\n");
+    }
+
+    for (int r = 0; r < num_procs; r++) {
+        for (int level = 0; level < PROFILE_MAX_LEVELS; level++) {
+            for (int phase = 0; phase < NUM_PHASES; phase++) {
+                double* entry = all + (((size_t)r * PROFILE_MAX_LEVELS + level) * NUM_PHASES + phase) * PROFILE_FIELDS;
+                if (entry[2] == 0.0) {
+                    continue;
+                }
+                if (json) {
+                    fprintf(out, "%s  {\"rank\": %d, \"level\": %d, \"phase\": \"%s\", "
+                                 "\"seconds\": %.9f, \"bytes\": %.0f, \"calls\": %.0f}",
+                            first ? "" : ",\n", r, level, phaseNames[phase], entry[0], entry[1], entry[2]);
+                } else {
+                    fprintf(out, "%d,%d,%s,%.9f,%.0f,%.0f\n",
+                            r, level, phaseNames[phase], entry[0], entry[1], entry[2]);
+                }
+                first = 0;
+            }
+        }
+    }
+
+    if (json) {
+        fprintf(out, "\n]\n");
+    }
+    fclose(out);
+    printf("Profile report written to %s\n", path);
+    free(all);
+}
@@ -0,0 +1,46 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <mpi.h>
+#include "trace.h"
+
+// Phases of the distributed multiplication that are timed separately
+typedef enum {
+    PHASE_SEND,      // Flatten + MPI_Send of operands or results
+    PHASE_RECV,      // MPI_Recv + unflatten, including the wait for the sender
+    PHASE_SPLIT,     // splitMatrix into quadrants
+    PHASE_ADDSUB,    // Operand sums, and C11..C22 formed on the children
+    PHASE_LEAF,      // Leaf standardMultiply
+    PHASE_COMBINE,   // Forming the result from the products or quadrants
+    PHASE_IDLE,      // Worker waiting for its next assignment
+    NUM_PHASES
+} ProfilePhase;
+
+#define PROFILE_MAX_LEVELS 32
+
+extern int profile_enabled;
+
+void profileEnable(void);
+void profileRecord(ProfilePhase phase, int level, double start, long long bytes);
+const char* profilePhaseName(int phase);
+
+// Gather every rank's counters on rank 0 and write them to path, as JSON if
+// the name ends in ".json" and as CSV otherwise. Must be called by all ranks.
+void profileReport(const char* path, int rank, int num_procs);
+
+// Hooks placed around each phase; a single branch when profiling and
+// tracing are both off. Phases also appear as slices in the trace.
+static inline double profileStart(void) {
+    return (profile_enabled || trace_enabled) ? MPI_Wtime() : 0.0;
+}
+
+static inline void profileStop(ProfilePhase phase, int level, double start, long long bytes) {
+    if (profile_enabled) {
+        profileRecord(phase, level, start, bytes);
+    }
+    if (trace_enabled) {
+        tracePhase(phase, level, start, bytes);
+    }
+}
+
+#endif // PROFILE_H
@@ -0,0 +1,54 @@
+#include "random_matrix.h"
+
+void generateRows(elem_t* flat, int first_row, int rows, int n, unsigned long long seed) {
+    for (int i = 0; i < rows; i++) {
+        elem_t* row = flat + (size_t)i * n;
+        for (int j = 0; j < n; j++) {
+            row[j] = randomEntry(seed, first_row + i, j);
+        }
+    }
+}
+
+
+void generateRandomMatrix(elem_t** matrix, int n, unsigned long long seed) {
+    for (int i = 0; i < n; i++) {
+        generateRows(matrix[i], i, 1, n, seed);
+    }
+}
+
+
+elem_t** generateMatrixDistributed(int n, unsigned long long seed, int rank, int num_procs) {
+    // Nothing to spread or gather: generate in place
+    if (num_procs == 1) {
+        elem_t** matrix = allocateMatrix(n);
+        generateRandomMatrix(matrix, n, seed);
+        return matrix;
+    }
+
+    int* counts = (int*)malloc(num_procs * sizeof(int));
+    int* displs = (int*)malloc(num_procs * sizeof(int));
+    int offset = 0;
+    for (int r = 0; r < num_procs; r++) {
+        int rows = n / num_procs + (r < n % num_procs ? 1 : 0);
+        counts[r] = rows * n;
+        displs[r] = offset;
+        offset += counts[r];
+    }
+
+    int my_rows = counts[rank] / n;
+    elem_t* block = (elem_t*)malloc(((size_t)counts[rank] + 1) * sizeof(elem_t));
+    generateRows(block, displs[rank] / n, my_rows, n, seed);
+
+    elem_t* flat = rank == 0 ? (elem_t*)malloc((size_t)n * n * sizeof(elem_t)) : NULL;
+    MPI_Gatherv(block, counts[rank], MPI_ELEM, flat, counts, displs, MPI_ELEM, 0, MPI_COMM_WORLD);
+
+    elem_t** matrix = NULL;
+    if (rank == 0) {
+        matrix = unflattenMatrix(flat, n);
+        free(flat);
+    }
+    free(block);
+    free(counts);
+    free(displs);
+    return matrix;
+}
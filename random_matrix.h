@@ -0,0 +1,38 @@
+#ifndef RANDOM_MATRIX_H
+#define RANDOM_MATRIX_H
+
+#include "matrix_utils.h"
+
+// Counter-based generator: every entry is a pure function of (seed, row, col),
+// so any rank can produce any block and the matrix does not depend on how the
+// rows are split between ranks.
+static inline unsigned long long randomAt(unsigned long long seed, int row, int col) {
+    // splitmix64 finalizer over the packed coordinates
+    unsigned long long z = seed + 0x9E3779B97F4A7C15ULL * ((((unsigned long long)row) << 32) | (unsigned int)col);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Entry (row, col) of the test matrix for seed: values 0-9 for easy verification,
+// or uniform in [-1, 1) for floating-point elements so rounding error shows
+static inline elem_t randomEntry(unsigned long long seed, int row, int col) {
+#if ELEM_IS_FLOAT
+    return (elem_t)((double)(randomAt(seed, row, col) >> 11) * 0x1.0p-52 - 1.0);
+#else
+    return (elem_t)(randomAt(seed, row, col) % 10);
+#endif
+}
+
+// Fill rows [first_row, first_row + rows) of an n-column matrix stored flat
+void generateRows(elem_t* flat, int first_row, int rows, int n, unsigned long long seed);
+
+// Fill a whole matrix on the calling rank
+void generateRandomMatrix(elem_t** matrix, int n, unsigned long long seed);
+
+// Every rank generates its own block of rows, which are gathered on rank 0.
+// Must be called by all ranks; returns the matrix on rank 0 and NULL elsewhere.
+// A single rank fills the matrix in place with generateRandomMatrix.
+elem_t** generateMatrixDistributed(int n, unsigned long long seed, int rank, int num_procs);
+
+#endif // RANDOM_MATRIX_H
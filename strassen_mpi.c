@@ -1,109 +1,391 @@
 #include "strassen_mpi.h"
+#include "comm.h"
+#include "window.h"
+#include "topology.h"
+#include "fault.h"
+#include "checkpoint.h"
+#include "task_dag.h"
+#include "morton.h"
 
-int** strassenMultiplyMPI(int** A, int** B, int n, int rank, int num_procs, int level) {
-    // Base case
-    if (n == 1) {
-        int** C = initializeMatrix(1);
-        C[0][0] = A[0][0] * B[0][0];
+// Size at or below which products are computed with standardMultiply and
+// never distributed; MIN_SIZE_THRESHOLD unless overridden at runtime
+static int size_threshold = MIN_SIZE_THRESHOLD;
+
+static int combine_mode = COMBINE_PARENT;
+
+// Checkpoint path of the strassenMultiplyMPI call about to run; see checkpoint.h
+static int task_path = 0;
+
+// Job id of the distributed multiplication this rank is working on, for
+// makeTag: counted by rank 0, taken from the work header by workers
+static int task_job = 0;
+static int next_job = 0;
+
+// C11..C22 as signed sums of products: {product index, sign}, with sign 0
+// ending a shorter list. Each quadrant is owned by the child of a product
+// it contains, so owners receive at most three products from siblings.
+static const int quadrantOwner[4] = { 6, 2, 1, 5 };
+static const int quadrantTerms[4][4][2] = {
+    { {0, 1}, {3, 1}, {4, -1}, {6, 1} },   // C11 = P1 + P4 - P5 + P7
+    { {2, 1}, {4, 1} },                    // C12 = P3 + P5
+    { {1, 1}, {3, 1} },                    // C21 = P2 + P4
+    { {0, 1}, {1, -1}, {2, 1}, {5, 1} }    // C22 = P1 - P2 + P3 + P6
+};
+
+
+void setSizeThreshold(int threshold) {
+    size_threshold = threshold;
+}
+
+
+int getSizeThreshold(void) {
+    return size_threshold;
+}
+
+
+void setCombineMode(int mode) {
+    combine_mode = mode;
+}
+
+
+int getCombineMode(void) {
+    return combine_mode;
+}
+
+
+// Whether this rank's children combine their own products: only when all
+// seven run on children that exchange messages, none may be given up on and
+// no product has to pass through this rank to be checkpointed
+static int childrenCombine(int rank, int n) {
+    if (combine_mode != COMBINE_CHILDREN || childRank(rank, 6) < 0 || task_timeout > 0 ||
+        checkpointEnabled()) {
+        return 0;
+    }
+    for (int i = 0; i < 7; i++) {
+        if (windowCanShare(childRank(rank, i), n)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+// Per-distribution state shared by the assignments to all children
+typedef struct {
+    int staged;                     // Operands copied into the window segment
+    elem_t* chunks[8];              // Flattened A11..A22, B11..B22, on first use
+    MPI_Request requests[7 * 8];    // Chunk sends still in flight
+    int request_child[7 * 8];       // ... and the child each one goes to
+    int num_requests;
+} Distribution;
+
+
+// Quadrant chunks the operands of product i are formed from: 0-3 are
+// A11..A22 and 4-7 are B11..B22
+static void productChunks(int i, int needed[8]) {
+    for (int q = 0; q < 8; q++) {
+        needed[q] = 0;
+    }
+    const int* left = strassenLeftTransform[i];
+    const int* right = strassenRightTransform[i];
+    needed[left[0]] = 1;
+    needed[left[1]] |= left[2] != 0;
+    needed[4 + right[0]] = 1;
+    needed[4 + right[1]] |= right[2] != 0;
+}
+
+
+// Hand product i of A*B to child_rank. Through a window transport the
+// operands are staged in this rank's segment once per distribution and only
+// the header is sent. Otherwise the header is followed by just the quadrants
+// product i reads, one chunk each, A's before B's, so the child can form
+// its left operand while the right one is still on the wire. Raw chunks are
+// sent without blocking and shared by all children.
+static void sendAssignment(elem_t** A, elem_t** B, elem_t** Q[8], int n, int i, int level,
+                           int child_rank, int combine, Distribution* dist) {
+    double send_start = profileStart();
+    int k = n / 2;
+    int codec = windowCanShare(child_rank, n) ? PAYLOAD_WINDOW : payload_codec;
+    int header[WORK_HEADER_INTS] = { n, i, level, codec, combine, checkpointChildPath(task_path, i), task_job };
+    long long bytes = sizeof(header);
+
+    if (codec == PAYLOAD_WINDOW) {
+        if (!dist->staged) {
+            flattenMatrixInto(A, windowOperand(n, 0), n);
+            flattenMatrixInto(B, windowOperand(n, 1), n);
+            windowSync();
+            dist->staged = 1;
+        }
+        MPI_Send(header, WORK_HEADER_INTS, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
+    } else {
+        int needed[8];
+        productChunks(i, needed);
+        MPI_Send(header, WORK_HEADER_INTS, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
+        for (int q = 0; q < 8; q++) {
+            if (!needed[q]) {
+                continue;
+            }
+            if (dist->chunks[q] == NULL) {
+                dist->chunks[q] = flattenMatrix(Q[q], k);
+            }
+            int tag = makeTag(task_job, level, i, TAG_KIND_OPERAND + q);
+            if (codec == PAYLOAD_RAW) {
+                dist->request_child[dist->num_requests] = child_rank;
+                MPI_Isend(dist->chunks[q], k * k, MPI_ELEM, child_rank, tag, MPI_COMM_WORLD,
+                          &dist->requests[dist->num_requests++]);
+                bytes += (long long)k * k * sizeof(elem_t);
+            } else {
+                bytes += sendPayload(dist->chunks[q], k * k, codec, child_rank, tag);
+            }
+        }
+    }
+    faultExpect(child_rank);
+    profileStop(PHASE_SEND, level, send_start, bytes);
+    traceSend(level, i, n, child_rank, bytes, send_start);
+}
+
+
+// Live child i of rank, or -1 if there is none or it was given up on
+static int liveChild(int rank, int i) {
+    int child_rank = childRank(rank, i);
+    return rankFailed(child_rank) ? -1 : child_rank;
+}
+
+
+// Wait for the chunk sends of a distribution and free the chunks. Sends to
+// children that were given up on may never complete, so they and the chunks
+// are left to faultFinalize.
+static void finishDistribution(Distribution* dist) {
+    int abandoned = 0;
+    for (int r = 0; r < dist->num_requests; r++) {
+        if (rankFailed(dist->request_child[r])) {
+            faultAbandon(&dist->requests[r], NULL);
+            abandoned = 1;
+        }
+    }
+    MPI_Waitall(dist->num_requests, dist->requests, MPI_STATUSES_IGNORE);
+    for (int q = 0; q < 8; q++) {
+        if (abandoned) {
+            faultAbandon(NULL, dist->chunks[q]);
+        } else {
+            free(dist->chunks[q]);
+        }
+    }
+}
+
+
+// Collect the products of this rank's live children into the entries of P
+// that are still NULL. Raw payloads and window completions are received in
+// whatever order the children finish; packed payloads need their size probed
+// and are taken in product order. A child given up on (fault.h) leaves its
+// P_i NULL.
+static void receiveProducts(elem_t** P[7], int n, int level, int rank) {
+    int k = n / 2;
+    MPI_Request requests[7];
+    int children[7];
+    elem_t* flat[7] = { NULL };
+
+    for (int i = 0; i < 7; i++) {
+        int child_rank = P[i] == NULL ? liveChild(rank, i) : -1;
+        requests[i] = MPI_REQUEST_NULL;
+        children[i] = child_rank;
+        if (child_rank < 0) {
+            continue;
+        }
+        int tag = makeTag(task_job, level, i, TAG_KIND_RESULT);
+        if (windowCanShare(child_rank, n)) {
+            // The child deposits P_i in our segment and signals with an empty message
+            MPI_Irecv(NULL, 0, MPI_INT, child_rank, tag, MPI_COMM_WORLD, &requests[i]);
+        } else if (resultCodec(payload_codec) == PAYLOAD_RAW) {
+            flat[i] = (elem_t*)malloc(k * k * sizeof(elem_t));
+            MPI_Irecv(flat[i], k * k, MPI_ELEM, child_rank, tag, MPI_COMM_WORLD, &requests[i]);
+        }
+    }
+
+    // Each completion is charged the time waited since the previous one
+    double recv_start = profileStart();
+    while (1) {
+        int failed;
+        int i = faultWaitany(7, requests, children, (void**)flat, &failed);
+        if (i == MPI_UNDEFINED) {
+            break;
+        }
+        if (failed) {
+            continue;
+        }
+        long long bytes = 0;
+        if (flat[i] != NULL) {
+            P[i] = unflattenMatrix(flat[i], k);
+            free(flat[i]);
+            bytes = (long long)k * k * sizeof(elem_t);
+        } else {
+            windowSync();
+            P[i] = unflattenMatrix(windowProduct(n, i), k);
+        }
+        profileStop(PHASE_RECV, level, recv_start, bytes);
+        traceRecv(level, i, k, children[i], bytes, recv_start);
+        recv_start = profileStart();
+    }
+
+    for (int i = 0; i < 7; i++) {
+        int child_rank = children[i];
+        if (child_rank < 0 || windowCanShare(child_rank, n) || resultCodec(payload_codec) == PAYLOAD_RAW) {
+            continue;
+        }
+        recv_start = profileStart();
+        int tag = makeTag(task_job, level, i, TAG_KIND_RESULT);
+        if (!faultProbe(child_rank, tag)) {
+            faultSink(child_rank, tag, payloadMaxBytes(k * k, resultCodec(payload_codec)));
+            continue;
+        }
+        elem_t* flatResult = (elem_t*)malloc(k * k * sizeof(elem_t));
+        long long bytes = recvPayload(flatResult, k * k, resultCodec(payload_codec), child_rank, tag);
+        P[i] = unflattenMatrix(flatResult, k);
+        free(flatResult);
+        profileStop(PHASE_RECV, level, recv_start, bytes);
+        traceRecv(level, i, k, child_rank, bytes, recv_start);
+    }
+}
+
+
+// With COMBINE_CHILDREN: collect C11..C22 from the owners of the quadrants
+static void receiveQuadrants(elem_t** C[4], int n, int level, int rank) {
+    int k = n / 2;
+    elem_t* flat = (elem_t*)malloc(k * k * sizeof(elem_t));
+    for (int q = 0; q < 4; q++) {
+        int owner = childRank(rank, quadrantOwner[q]);
+        double recv_start = profileStart();
+        long long bytes = recvPayload(flat, k * k, resultCodec(payload_codec), owner,
+                                      makeTag(task_job, level, q, TAG_KIND_QUADRANT));
+        C[q] = unflattenMatrix(flat, k);
+        profileStop(PHASE_RECV, level, recv_start, bytes);
+        traceRecv(level, quadrantOwner[q], k, owner, bytes, recv_start);
+    }
+    free(flat);
+}
+
+
+elem_t** strassenMultiplyMPI(elem_t** A, elem_t** B, int n, int rank, int num_procs, int level) {
+    heartbeatPoll();
+
+    // Use standard multiplication for small matrices, down to the 1x1 base
+    // case, so it is reduced under --mod and goes through the leaf kernel
+    if (n <= size_threshold || n == 1) {
+        double leaf_start = profileStart();
+        elem_t** C = standardMultiply(A, B, n);
+        profileStop(PHASE_LEAF, level, leaf_start, 0);
         return C;
     }
 
-    // Use standard multiplication for small matrices
-    if (n <= MIN_SIZE_THRESHOLD) {
-        return standardMultiply(A, B, n);
+    // A subtree this rank computes alone runs as a task graph on its threads,
+    // or in Morton layout. Neither saves checkpoints, so main rejects them
+    // with --checkpoint-dir.
+    int local_engine = dag_threads > 1 || matrix_layout == LAYOUT_MORTON;
+    if (local_engine && !shouldDistribute(n, level, num_procs, rank)) {
+        double local_start = profileStart();
+        elem_t** C = dag_threads > 1 ? dagMultiply(A, B, n, size_threshold)
+                                     : mortonStrassen(A, B, n, size_threshold);
+        profileStop(PHASE_LEAF, level, local_start, 0);
+        return C;
     }
 
     int k = n / 2;
 
     // Divide matrices into quadrants
-    int** A11 = initializeMatrix(k);
-    int** A12 = initializeMatrix(k);
-    int** A21 = initializeMatrix(k);
-    int** A22 = initializeMatrix(k);
+    elem_t** A11 = allocateMatrix(k);
+    elem_t** A12 = allocateMatrix(k);
+    elem_t** A21 = allocateMatrix(k);
+    elem_t** A22 = allocateMatrix(k);
 
-    int** B11 = initializeMatrix(k);
-    int** B12 = initializeMatrix(k);
-    int** B21 = initializeMatrix(k);
-    int** B22 = initializeMatrix(k);
+    elem_t** B11 = allocateMatrix(k);
+    elem_t** B12 = allocateMatrix(k);
+    elem_t** B21 = allocateMatrix(k);
+    elem_t** B22 = allocateMatrix(k);
 
+    double split_start = profileStart();
     splitMatrix(A, A11, A12, A21, A22, k);
     splitMatrix(B, B11, B12, B21, B22, k);
+    profileStop(PHASE_SPLIT, level, split_start, 0);
 
-    int** P[7];
+    elem_t** P[7] = { NULL };
+    elem_t** C11 = NULL;
+    elem_t** C12 = NULL;
+    elem_t** C21 = NULL;
+    elem_t** C22 = NULL;
+    int combined = 0;
+
+    // Products saved by an earlier run of this task need no work
+    int path = task_path;
+    for (int i = 0; i < 7; i++) {
+        P[i] = checkpointLoad(checkpointChildPath(path, i), k);
+    }
+    int restored = 0;
+    for (int i = 0; i < 7; i++) {
+        restored |= P[i] != NULL;
+    }
 
     // Check if we should distribute work to child processes
     if (shouldDistribute(n, level, num_procs, rank)) {
-        int num_children = 0;
+        Distribution dist = { 0 };
+        elem_t** Q[8] = { A11, A12, A21, A22, B11, B12, B21, B22 };
+        combined = !restored && childrenCombine(rank, n);
         for (int i = 0; i < 7; i++) {
-            int child_rank = rank * 7 + (i + 1);
-            if (child_rank < num_procs) {
-                num_children++;
-
-                // Flatten and send matrices to child
-                int* flatA = flattenMatrix(A, n);
-                int* flatB = flattenMatrix(B, n);
-
-                MPI_Send(&n, 1, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
-                MPI_Send(&i, 1, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
-                MPI_Send(&level, 1, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
-                MPI_Send(flatA, n * n, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
-                MPI_Send(flatB, n * n, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
-
-                free(flatA);
-                free(flatB);
+            int child_rank = liveChild(rank, i);
+            if (child_rank >= 0 && P[i] == NULL) {
+                sendAssignment(A, B, Q, n, i, level, child_rank, combined, &dist);
             }
         }
 
-        // Compute products: receive from children or compute locally
-        for (int i = 0; i < 7; i++) {
-            int child_rank = rank * 7 + (i + 1);
-            if (child_rank < num_procs) {
-                // Receive result from child
-                int* flatResult = (int*)malloc(k * k * sizeof(int));
-                MPI_Recv(flatResult, k * k, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                P[i] = unflattenMatrix(flatResult, k);
-                free(flatResult);
-            } else {
-                // Compute locally (no more children available)
-                P[i] = computeStrassenProductMPI(A11, A12, A21, A22, B11, B12, B21, B22, k, rank, num_procs, level, i);
+        // Children run concurrently; the remaining products are computed
+        // locally once all of theirs are in, since a local product may hand
+        // work to the same children and reuse the window segment
+        if (combined) {
+            elem_t** Cq[4];
+            receiveQuadrants(Cq, n, level, rank);
+            C11 = Cq[0]; C12 = Cq[1]; C21 = Cq[2]; C22 = Cq[3];
+        } else {
+            elem_t** received[7];
+            for (int i = 0; i < 7; i++) {
+                received[i] = P[i];
+            }
+            receiveProducts(P, n, level, rank);
+            for (int i = 0; i < 7; i++) {
+                if (P[i] != received[i]) {
+                    checkpointSave(checkpointChildPath(path, i), P[i], k);
+                }
             }
         }
-    } else {
-        // No distribution - compute all products locally
-        for (int i = 0; i < 7; i++) {
+        finishDistribution(&dist);
+    }
+
+    // Compute locally (no children available, or one was lost)
+    for (int i = 0; i < 7; i++) {
+        if (P[i] == NULL && !combined) {
+            task_path = checkpointChildPath(path, i);
             P[i] = computeStrassenProductMPI(A11, A12, A21, A22, B11, B12, B21, B22, k, rank, num_procs, level, i);
+            checkpointSave(task_path, P[i], k);
         }
     }
+    task_path = path;
 
-    // Calculate result quadrants using Strassen's formulas
-    // C11 = P1 + P4 - P5 + P7
-    int** temp1 = addMatrices(P[0], P[3], k);
-    int** temp2 = subtractMatrices(temp1, P[4], k);
-    int** C11 = addMatrices(temp2, P[6], k);
-    freeMatrix(temp1, k);
-    freeMatrix(temp2, k);
-
-    // C12 = P3 + P5
-    int** C12 = addMatrices(P[2], P[4], k);
-
-    // C21 = P2 + P4
-    int** C21 = addMatrices(P[1], P[3], k);
-
-    // C22 = P1 - P2 + P3 + P6
-    temp1 = subtractMatrices(P[0], P[1], k);
-    temp2 = addMatrices(temp1, P[2], k);
-    int** C22 = addMatrices(temp2, P[5], k);
-    freeMatrix(temp1, k);
-    freeMatrix(temp2, k);
-
-    // Combine result quadrants
-    int** C = initializeMatrix(n);
-    combineBlocks(C, C11, C12, C21, C22, k);
+    // Form the result from the children's quadrants, or straight from the
+    // products using Strassen's formulas:
+    // C11 = P1 + P4 - P5 + P7, C12 = P3 + P5, C21 = P2 + P4, C22 = P1 - P2 + P3 + P6
+    double combine_start = profileStart();
+    elem_t** C = allocateMatrix(n);
+    if (combined) {
+        combineBlocks(C, C11, C12, C21, C22, k);
+    } else {
+        assembleProducts(C, P, k);
+    }
+    profileStop(PHASE_COMBINE, level, combine_start, 0);
 
     // Free memory
     freeMatrix(A11, k); freeMatrix(A12, k); freeMatrix(A21, k); freeMatrix(A22, k);
     freeMatrix(B11, k); freeMatrix(B12, k); freeMatrix(B21, k); freeMatrix(B22, k);
     for (int i = 0; i < 7; i++) {
+        // Our result supersedes the products; the parent checkpoints it
+        checkpointRemove(checkpointChildPath(path, i), k);
         freeMatrix(P[i], k);
     }
     freeMatrix(C11, k); freeMatrix(C12, k); freeMatrix(C21, k); freeMatrix(C22, k);
@@ -111,13 +393,15 @@ int** strassenMultiplyMPI(int** A, int** B, int n, int rank, int num_procs, int
     return C;
 }
 
-int** computeStrassenProductMPI(int** A11, int** A12, int** A21, int** A22,
-                               int** B11, int** B12, int** B21, int** B22,
+elem_t** computeStrassenProductMPI(elem_t** A11, elem_t** A12, elem_t** A21, elem_t** A22,
+                               elem_t** B11, elem_t** B12, elem_t** B21, elem_t** B22,
                                int k, int rank, int num_procs, int level, int product_index) {
-    int** tempA = NULL;
-    int** tempB = NULL;
-    int** result = NULL;
+    elem_t** tempA = NULL;
+    elem_t** tempB = NULL;
+    elem_t** result = NULL;
 
+    double task_start = traceStart();
+    double addsub_start = profileStart();
     switch (product_index) {
         case 0: // P1 = (A11 + A22) * (B11 + B22)
             tempA = addMatrices(A11, A22, k);
@@ -125,23 +409,19 @@ int** computeStrassenProductMPI(int** A11, int** A12, int** A21, int** A22,
             break;
         case 1: // P2 = (A21 + A22) * B11
             tempA = addMatrices(A21, A22, k);
-            tempB = initializeMatrix(k);
-            copyMatrix(B11, tempB, k);
+            tempB = duplicateMatrix(B11, k);
             break;
         case 2: // P3 = A11 * (B12 - B22)
-            tempA = initializeMatrix(k);
-            copyMatrix(A11, tempA, k);
+            tempA = duplicateMatrix(A11, k);
             tempB = subtractMatrices(B12, B22, k);
             break;
         case 3: // P4 = A22 * (B21 - B11)
-            tempA = initializeMatrix(k);
-            copyMatrix(A22, tempA, k);
+            tempA = duplicateMatrix(A22, k);
             tempB = subtractMatrices(B21, B11, k);
             break;
         case 4: // P5 = (A11 + A12) * B22
             tempA = addMatrices(A11, A12, k);
-            tempB = initializeMatrix(k);
-            copyMatrix(B22, tempB, k);
+            tempB = duplicateMatrix(B22, k);
             break;
         case 5: // P6 = (A21 - A11) * (B11 + B12)
             tempA = subtractMatrices(A21, A11, k);
@@ -152,19 +432,21 @@ int** computeStrassenProductMPI(int** A11, int** A12, int** A21, int** A22,
             tempB = addMatrices(B21, B22, k);
             break;
     }
+    profileStop(PHASE_ADDSUB, level, addsub_start, 0);
 
     result = strassenMultiplyMPI(tempA, tempB, k, rank, num_procs, level + 1);
 
     freeMatrix(tempA, k);
     freeMatrix(tempB, k);
 
+    traceTask(level, product_index, k, task_start);
     return result;
 }
 
 
 int shouldDistribute(int n, int level, int num_procs, int rank) {
     // Condition 1: Matrix must be bigger than minimum threshold
-    if (n <= MIN_SIZE_THRESHOLD) {
+    if (n <= size_threshold) {
         return 0;
     }
 
@@ -174,12 +456,304 @@ int shouldDistribute(int n, int level, int num_procs, int rank) {
     }
 
     // Condition 3: At least one child process must be available
-    // Using tree structure: rank uses children at positions rank*7+1 to rank*7+7
-    int first_child = rank * 7 + 1;
-    if (first_child >= num_procs) {
+    // Children of a rank are childRank(rank, 0..6); see topology.h. A caller
+    // passing num_procs = 1 runs a single-process tree, whatever the world size.
+    if (num_procs <= 1 || childRank(rank, 0) < 0) {
         return 0;
     }
 
     // All conditions met - distribute work
     return 1;
 }
+
+
+// Child side of COMBINE_CHILDREN for product i of parent's size-n
+// distribution: pass P_i to the owners of the quadrants that use it, and if
+// this child owns a quadrant, gather its other products from the siblings,
+// form it and send it to the parent. The owners of C11 and C22 only receive
+// and every other child sends before it receives, so the blocking exchange
+// cannot deadlock. Each message is traced with its real destination.
+// Returns the bytes sent.
+static long long combineProducts(int parent_rank, int n, int i, int codec, int level, elem_t** P_i) {
+    int k = n / 2;
+    long long bytes = 0;
+    elem_t* flat = flattenMatrix(P_i, k);
+    int owned = -1;
+
+    for (int q = 0; q < 4; q++) {
+        if (quadrantOwner[q] == i) {
+            owned = q;
+            continue;
+        }
+        for (int t = 0; t < 4 && quadrantTerms[q][t][1] != 0; t++) {
+            if (quadrantTerms[q][t][0] == i) {
+                int owner = childRank(parent_rank, quadrantOwner[q]);
+                double send_start = traceStart();
+                long long sent = sendPayload(flat, k * k, codec, owner, makeTag(task_job, level, i, TAG_KIND_COMBINE));
+                traceSend(level, i, k, owner, sent, send_start);
+                bytes += sent;
+            }
+        }
+    }
+
+    if (owned >= 0) {
+        elem_t** C = NULL;
+        for (int t = 0; t < 4 && quadrantTerms[owned][t][1] != 0; t++) {
+            int j = quadrantTerms[owned][t][0];
+            int sign = quadrantTerms[owned][t][1];
+            elem_t** term = P_i;
+            if (j != i) {
+                int sibling = childRank(parent_rank, j);
+                double recv_start = profileStart();
+                long long received = recvPayload(flat, k * k, codec, sibling,
+                                                 makeTag(task_job, level, j, TAG_KIND_COMBINE));
+                profileStop(PHASE_RECV, level, recv_start, received);
+                traceRecv(level, j, k, sibling, received, recv_start);
+                term = wrapFlatMatrix(flat, k);
+            }
+            double addsub_start = profileStart();
+            if (C == NULL) {
+                C = duplicateMatrix(term, k);
+            } else {
+                elem_t** sum = sign > 0 ? addMatrices(C, term, k) : subtractMatrices(C, term, k);
+                freeMatrix(C, k);
+                C = sum;
+            }
+            profileStop(PHASE_ADDSUB, level, addsub_start, 0);
+            if (term != P_i) {
+                free(term);
+            }
+        }
+        flattenMatrixInto(C, flat, k);
+        double send_start = traceStart();
+        long long sent = sendPayload(flat, k * k, codec, parent_rank, makeTag(task_job, level, owned, TAG_KIND_QUADRANT));
+        traceSend(level, i, k, parent_rank, sent, send_start);
+        bytes += sent;
+        freeMatrix(C, k);
+    }
+    free(flat);
+    return bytes;
+}
+
+
+// One operand of product i from its flat chunks X11..X22
+static elem_t** formChunkOperand(elem_t* chunks[4], const int transform[7][3], int i, int k) {
+    const int* t = transform[i];
+    if (t[2] == 0) {
+        return unflattenMatrix(chunks[t[0]], k);
+    }
+    elem_t** X = wrapFlatMatrix(chunks[t[0]], k);
+    elem_t** Y = wrapFlatMatrix(chunks[t[1]], k);
+    elem_t** M = t[2] > 0 ? addMatrices(X, Y, k) : subtractMatrices(X, Y, k);
+    free(X);
+    free(Y);
+    return M;
+}
+
+
+// Child side of sendAssignment: receive the chunks of product i's operands
+// and form each operand as soon as its last chunk is in, while the others
+// are still arriving. Returns the bytes received.
+static long long receiveOperands(int parent_rank, int n, int i, int codec, int level,
+                                 elem_t*** tempA, elem_t*** tempB) {
+    int k = n / 2;
+    int needed[8];
+    int pending[2] = { 0, 0 };   // Chunks still to come for A and for B
+    elem_t* chunks[8] = { NULL };
+    MPI_Request requests[8];
+    long long bytes = 0;
+
+    productChunks(i, needed);
+    for (int q = 0; q < 8; q++) {
+        requests[q] = MPI_REQUEST_NULL;
+        if (!needed[q]) {
+            continue;
+        }
+        chunks[q] = (elem_t*)malloc(k * k * sizeof(elem_t));
+        pending[q / 4]++;
+        if (codec == PAYLOAD_RAW) {
+            MPI_Irecv(chunks[q], k * k, MPI_ELEM, parent_rank, makeTag(task_job, level, i, TAG_KIND_OPERAND + q),
+                      MPI_COMM_WORLD, &requests[q]);
+        }
+    }
+
+    int next = 0;   // Packed chunks are received in order
+    while (pending[0] + pending[1] > 0) {
+        double recv_start = profileStart();
+        int q;
+        long long chunk_bytes;
+        if (codec == PAYLOAD_RAW) {
+            MPI_Waitany(8, requests, &q, MPI_STATUS_IGNORE);
+            chunk_bytes = (long long)k * k * sizeof(elem_t);
+        } else {
+            while (!needed[next]) {
+                next++;
+            }
+            q = next++;
+            chunk_bytes = recvPayload(chunks[q], k * k, codec, parent_rank,
+                                      makeTag(task_job, level, i, TAG_KIND_OPERAND + q));
+        }
+        profileStop(PHASE_RECV, level, recv_start, chunk_bytes);
+        bytes += chunk_bytes;
+
+        if (--pending[q / 4] == 0) {
+            double addsub_start = profileStart();
+            if (q < 4) {
+                *tempA = formChunkOperand(chunks, strassenLeftTransform, i, k);
+            } else {
+                *tempB = formChunkOperand(chunks + 4, strassenRightTransform, i, k);
+            }
+            profileStop(PHASE_ADDSUB, level + 1, addsub_start, 0);
+        }
+    }
+
+    for (int q = 0; q < 8; q++) {
+        free(chunks[q]);
+    }
+    return bytes;
+}
+
+
+void workerProcess(int rank, int num_procs) {
+    while (1) {
+        MPI_Status status;
+        int header[WORK_HEADER_INTS];
+
+        // Wait for the next work header. Its bytes are profiled as idle time
+        // but traced with the operands, as the parent's send is.
+        double idle_start = profileStart();
+        MPI_Recv(header, WORK_HEADER_INTS, MPI_INT, MPI_ANY_SOURCE, TAG_WORK, MPI_COMM_WORLD, &status);
+
+        int n = header[HEADER_N];
+        int product_index = header[HEADER_PRODUCT];
+        int level = header[HEADER_LEVEL];
+        int codec = header[HEADER_CODEC];
+
+        // Check if this is a termination signal (n = 0); pass it down the tree
+        if (n == 0) {
+            terminateWorkers(rank);
+            break;
+        }
+
+        int parent_rank = status.MPI_SOURCE;
+        profileStop(PHASE_IDLE, level, idle_start, sizeof(header));
+        heartbeatBegin(parent_rank);
+        task_path = header[HEADER_PATH];
+        task_job = header[HEADER_JOB];
+
+        int k = n / 2;
+        int windowed = codec == PAYLOAD_WINDOW;
+        elem_t** result;
+        long long bytes = 0;
+        double recv_start = profileStart();
+
+        if (windowed) {
+            // Read A and B in place from the parent's segment
+            elem_t** A;
+            elem_t** B;
+            windowSync();
+            windowReadOperands(parent_rank, n, &A, &B);
+            if (transport == TRANSPORT_RMA) {
+                bytes = 2LL * n * n * sizeof(elem_t);
+            }
+            profileStop(PHASE_RECV, level, recv_start, bytes);
+            traceRecv(level, product_index, n, parent_rank, bytes + sizeof(header), recv_start);
+
+            // Divide into quadrants
+            elem_t** A11 = allocateMatrix(k);
+            elem_t** A12 = allocateMatrix(k);
+            elem_t** A21 = allocateMatrix(k);
+            elem_t** A22 = allocateMatrix(k);
+            elem_t** B11 = allocateMatrix(k);
+            elem_t** B12 = allocateMatrix(k);
+            elem_t** B21 = allocateMatrix(k);
+            elem_t** B22 = allocateMatrix(k);
+
+            double split_start = profileStart();
+            splitMatrix(A, A11, A12, A21, A22, k);
+            splitMatrix(B, B11, B12, B21, B22, k);
+            profileStop(PHASE_SPLIT, level, split_start, 0);
+            windowReleaseOperands(A, B, n);
+
+            // Compute the specific product based on product_index
+            result = computeStrassenProductMPI(A11, A12, A21, A22, B11, B12, B21, B22,
+                                               k, rank, num_procs, level + 1, product_index);
+
+            freeMatrix(A11, k); freeMatrix(A12, k); freeMatrix(A21, k); freeMatrix(A22, k);
+            freeMatrix(B11, k); freeMatrix(B12, k); freeMatrix(B21, k); freeMatrix(B22, k);
+        } else {
+            // Receive the quadrant chunks, forming the operands on the way
+            double task_start = traceStart();
+            elem_t** tempA = NULL;
+            elem_t** tempB = NULL;
+            bytes = receiveOperands(parent_rank, n, product_index, codec, level, &tempA, &tempB);
+            traceRecv(level, product_index, n, parent_rank, bytes + sizeof(header), recv_start);
+            faultMaybeStall(rank);
+
+            result = strassenMultiplyMPI(tempA, tempB, k, rank, num_procs, level + 2);
+            freeMatrix(tempA, k);
+            freeMatrix(tempB, k);
+            traceTask(level + 1, product_index, k, task_start);
+        }
+
+        // Send result back to parent, deposit it in the parent's P slot, or
+        // combine it with the siblings' products
+        int result_tag = makeTag(task_job, level, product_index, TAG_KIND_RESULT);
+        double send_start = profileStart();
+        if (header[HEADER_COMBINE]) {
+            bytes = combineProducts(parent_rank, n, product_index, resultCodec(codec), level, result);
+        } else if (windowed) {
+            windowWriteProduct(parent_rank, n, product_index, result);
+            windowSync();
+            MPI_Send(NULL, 0, MPI_INT, parent_rank, result_tag, MPI_COMM_WORLD);
+            bytes = transport == TRANSPORT_RMA ? (long long)k * k * sizeof(elem_t) : 0;
+        } else {
+            elem_t* flatResult = flattenMatrix(result, k);
+            bytes = sendPayload(flatResult, k * k, resultCodec(codec), parent_rank, result_tag);
+            free(flatResult);
+        }
+        profileStop(PHASE_SEND, level, send_start, bytes);
+        if (!header[HEADER_COMBINE]) {
+            traceSend(level, product_index, k, parent_rank, bytes, send_start);
+        }
+        heartbeatEnd();
+
+        freeMatrix(result, k);
+    }
+}
+
+
+void terminateWorkers(int rank) {
+    // Children given up on may still be finishing with their own subtrees
+    faultDrain();
+    int terminate[WORK_HEADER_INTS] = { 0 };
+    for (int i = 0; i < 7; i++) {
+        int child_rank = childRank(rank, i);
+        if (child_rank < 0) {
+            continue;
+        }
+        if (rankDead(child_rank)) {
+            // Pass the signal on to the dead child's children ourselves
+            terminateWorkers(child_rank);
+        } else {
+            MPI_Send(terminate, WORK_HEADER_INTS, MPI_INT, child_rank, TAG_WORK, MPI_COMM_WORLD);
+        }
+    }
+}
+
+
+elem_t** runDistributedMultiply(elem_t** A, elem_t** B, int n, int rank, int num_procs) {
+    if (transport != TRANSPORT_MSG) {
+        windowAttach(n, rank, num_procs);
+    }
+    checkpointBegin(A, B, n, rank);
+    task_path = 0;
+    task_job = next_job++;
+    if (rank != 0) {
+        workerProcess(rank, num_procs);
+        return NULL;
+    }
+    elem_t** C = strassenMultiplyMPI(A, B, n, rank, num_procs, 0);
+    terminateWorkers(rank);
+    return C;
+}
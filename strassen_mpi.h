@@ -2,20 +2,46 @@
 #define STRASSEN_MPI_H
 
 #include "matrix_utils.h"
+#include "profile.h"
 #include <mpi.h>
 #include <math.h>
 
 #define MAX_TREE_HEIGHT 5    // Maximum height of the process tree (reduced to avoid deadlock)
 #define MIN_SIZE_THRESHOLD 64 // Minimum size for parallel processing
 
-int** strassenMultiplyMPI(int** A, int** B, int n, int rank, int num_procs, int level);
+// Runtime override of MIN_SIZE_THRESHOLD; must be identical on all ranks
+void setSizeThreshold(int threshold);
+int getSizeThreshold(void);
+
+// Where C11..C22 are formed from P1..P7 when all seven products run on
+// children. COMBINE_PARENT collects the products and adds them up on the
+// parent. COMBINE_CHILDREN has the children of P7, P3, P2 and P6 each gather
+// the products of one quadrant from their siblings and send the parent only
+// that quadrant. Must be identical on all ranks.
+#define COMBINE_PARENT   0
+#define COMBINE_CHILDREN 1
+void setCombineMode(int mode);
+int getCombineMode(void);
+
+elem_t** strassenMultiplyMPI(elem_t** A, elem_t** B, int n, int rank, int num_procs, int level);
 
 // Strassen computation functions for MPI
-int** computeStrassenProductMPI(int** A11, int** A12, int** A21, int** A22,
-                               int** B11, int** B12, int** B21, int** B22,
+elem_t** computeStrassenProductMPI(elem_t** A11, elem_t** A12, elem_t** A21, elem_t** A22,
+                               elem_t** B11, elem_t** B12, elem_t** B21, elem_t** B22,
                                int k, int rank, int num_procs, int level, int product_index);
 
 // Helper function to determine if work should be distributed
 int shouldDistribute(int n, int level, int num_procs, int rank);
 
+// Worker loop for ranks != 0: serve assignments until a parent sends n = 0
+void workerProcess(int rank, int num_procs);
+
+// Send the termination signal (n = 0) to rank's children in the tree; each
+// worker passes it on to its own children before it exits
+void terminateWorkers(int rank);
+
+// Run one distributed multiplication on all ranks. Rank 0 returns C once the
+// workers have been terminated; every other rank serves work and returns NULL.
+elem_t** runDistributedMultiply(elem_t** A, elem_t** B, int n, int rank, int num_procs);
+
 #endif // STRASSEN_MPI_H
@@ -0,0 +1,109 @@
+#include "strassen_prepared.h"
+
+// Form the operand of product i from quadrants Q. Returns the quadrant itself
+// when no addition is needed, so the caller must only free it if *owned is set.
+static elem_t** formOperand(elem_t** Q[4], const int transform[7][3], int i, int k, int* owned) {
+    const int* t = transform[i];
+    *owned = t[2] != 0;
+    if (t[2] > 0) {
+        return addMatrices(Q[t[0]], Q[t[1]], k);
+    }
+    if (t[2] < 0) {
+        return subtractMatrices(Q[t[0]], Q[t[1]], k);
+    }
+    return Q[t[0]];
+}
+
+static void splitQuadrants(elem_t** M, elem_t** Q[4], int k) {
+    for (int q = 0; q < 4; q++) {
+        Q[q] = allocateMatrix(k);
+    }
+    splitMatrix(M, Q[0], Q[1], Q[2], Q[3], k);
+}
+
+static void freeQuadrants(elem_t** Q[4], int k) {
+    for (int q = 0; q < 4; q++) {
+        freeMatrix(Q[q], k);
+    }
+}
+
+
+PreparedOperand* prepareOperand(elem_t** M, int n, int side) {
+    PreparedOperand* prepared = (PreparedOperand*)calloc(1, sizeof(PreparedOperand));
+    prepared->n = n;
+    prepared->side = side;
+
+    if (n <= SEQUENTIAL_CUTOFF) {
+        prepared->leaf = duplicateMatrix(M, n);
+        return prepared;
+    }
+
+    int k = n / 2;
+    elem_t** Q[4];
+    splitQuadrants(M, Q, k);
+
+    const int (*transform)[3] = side == PREPARED_LEFT ? strassenLeftTransform : strassenRightTransform;
+    for (int i = 0; i < 7; i++) {
+        int owned;
+        elem_t** operand = formOperand(Q, transform, i, k, &owned);
+        prepared->sub[i] = prepareOperand(operand, k, side);
+        if (owned) {
+            freeMatrix(operand, k);
+        }
+    }
+
+    freeQuadrants(Q, k);
+    return prepared;
+}
+
+
+void freePreparedOperand(PreparedOperand* prepared) {
+    if (!prepared) {
+        return;
+    }
+    if (prepared->leaf) {
+        freeMatrix(prepared->leaf, prepared->n);
+    }
+    for (int i = 0; i < 7; i++) {
+        freePreparedOperand(prepared->sub[i]);
+    }
+    free(prepared);
+}
+
+
+elem_t** strassenMultiplyPrepared(PreparedOperand* prepared, elem_t** other) {
+    int n = prepared->n;
+
+    if (prepared->leaf) {
+        if (prepared->side == PREPARED_LEFT) {
+            return standardMultiply(prepared->leaf, other, n);
+        }
+        return standardMultiply(other, prepared->leaf, n);
+    }
+
+    int k = n / 2;
+    elem_t** Q[4];
+    splitQuadrants(other, Q, k);
+
+    // Only the non-prepared operand still needs its sums formed
+    const int (*transform)[3] = prepared->side == PREPARED_LEFT ? strassenRightTransform : strassenLeftTransform;
+    elem_t** P[7];
+    for (int i = 0; i < 7; i++) {
+        int owned;
+        elem_t** operand = formOperand(Q, transform, i, k, &owned);
+        P[i] = strassenMultiplyPrepared(prepared->sub[i], operand);
+        if (owned) {
+            freeMatrix(operand, k);
+        }
+    }
+    freeQuadrants(Q, k);
+
+    elem_t** C = allocateMatrix(n);
+    assembleProducts(C, P, k);
+
+    for (int i = 0; i < 7; i++) {
+        freeMatrix(P[i], k);
+    }
+
+    return C;
+}
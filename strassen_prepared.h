@@ -0,0 +1,26 @@
+#ifndef STRASSEN_PREPARED_H
+#define STRASSEN_PREPARED_H
+
+#include "matrix_utils.h"
+
+// Which operand of the product has been prepared
+#define PREPARED_LEFT  0   // A is fixed, B changes between calls
+#define PREPARED_RIGHT 1   // B is fixed, A changes between calls
+
+// An operand whose Strassen sums (A11+A22, A21+A22, ...) have been formed
+// once for every recursion level. Only the leaves hold matrix data.
+typedef struct PreparedOperand {
+    int n;
+    int side;
+    elem_t** leaf;                     // Set when n <= SEQUENTIAL_CUTOFF
+    struct PreparedOperand* sub[7];    // Transformed operand for P1..P7
+} PreparedOperand;
+
+PreparedOperand* prepareOperand(elem_t** M, int n, int side);
+void freePreparedOperand(PreparedOperand* prepared);
+
+// Multiply a prepared operand by an ordinary matrix of the same size.
+// For PREPARED_LEFT this computes prepared * other, otherwise other * prepared.
+elem_t** strassenMultiplyPrepared(PreparedOperand* prepared, elem_t** other);
+
+#endif // STRASSEN_PREPARED_H
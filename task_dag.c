@@ -0,0 +1,350 @@
+// pthread_cond_timedwait and clock_gettime are POSIX, not C99
+#define _POSIX_C_SOURCE 200809L
+
+#include "task_dag.h"
+#include "modular.h"
+#include "fault.h"
+#include "alloc.h"
+#include <pthread.h>
+#include <time.h>
+
+int dag_threads = 1;
+
+// One multiplication C = A * B in the graph
+typedef struct DagNode {
+    elem_t** A;
+    elem_t** B;
+    int owns_a;                  // A was formed for this node (else a view)
+    int owns_b;
+    elem_t** C;                  // Accumulated product by product
+    int written[4];              // Quadrant of C holds a first product
+    int n;
+    int remaining;               // Products not yet added into C
+    pthread_mutex_t quadrant_lock[4];
+    struct DagNode* parent;      // NULL for the root
+    int product;                 // Which of the parent's products this is
+    int domain;                  // NUMA domain whose queue runs its products
+} DagNode;
+
+typedef struct {
+    DagNode* node;
+    int product;
+} DagTask;
+
+// LIFO stack of ready tasks
+typedef struct {
+    DagTask* tasks;
+    int count;
+    int capacity;
+} DagQueue;
+
+static struct {
+    DagQueue* queues;            // One per NUMA domain (one without --numa)
+    int num_domains;
+    int pending;                 // Tasks in all queues
+    int finished;                // The root node is complete
+    int cutoff;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} pool;
+
+
+void setDagThreads(int threads) {
+    dag_threads = threads < 1 ? 1 : threads;
+}
+
+
+// Row pointers to quadrant q (0 = X11, 1 = X12, 2 = X21, 3 = X22) of M.
+// Release with free().
+static elem_t** quadrantView(elem_t** M, int k, int q) {
+    elem_t** view = (elem_t**)malloc(k * sizeof(elem_t*));
+    int row = (q / 2) * k;
+    int col = (q % 2) * k;
+    for (int i = 0; i < k; i++) {
+        view[i] = M[row + i] + col;
+    }
+    return view;
+}
+
+
+static void releaseOperand(elem_t** M, int n, int owned) {
+    if (owned) {
+        freeMatrix(M, n);
+    } else {
+        free(M);
+    }
+}
+
+
+// Operand of product i from the quadrant views of X. Sums are new matrices
+// (*owned set); a single quadrant is returned as a fresh view of it.
+static elem_t** formOperand(elem_t** X, const int transform[7][3], int i, int k, int* owned) {
+    const int* t = transform[i];
+    elem_t** first = quadrantView(X, k, t[0]);
+    *owned = t[2] != 0;
+    if (t[2] == 0) {
+        return first;
+    }
+    elem_t** second = quadrantView(X, k, t[1]);
+    elem_t** M = t[2] > 0 ? addMatrices(first, second, k) : subtractMatrices(first, second, k);
+    free(first);
+    free(second);
+    return M;
+}
+
+
+static void pushTask(DagNode* node, int product) {
+    pthread_mutex_lock(&pool.lock);
+    DagQueue* queue = &pool.queues[node->domain];
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? 2 * queue->capacity : 64;
+        queue->tasks = (DagTask*)realloc(queue->tasks, queue->capacity * sizeof(DagTask));
+    }
+    queue->tasks[queue->count].node = node;
+    queue->tasks[queue->count].product = product;
+    queue->count++;
+    pool.pending++;
+    pthread_cond_signal(&pool.ready);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+
+static DagNode* newNode(elem_t** A, int owns_a, elem_t** B, int owns_b, int n, DagNode* parent, int product,
+                        int domain) {
+    DagNode* node = (DagNode*)malloc(sizeof(DagNode));
+    node->A = A;
+    node->B = B;
+    node->owns_a = owns_a;
+    node->owns_b = owns_b;
+    node->C = allocateMatrix(n);
+    node->n = n;
+    node->remaining = 7;
+    for (int q = 0; q < 4; q++) {
+        node->written[q] = 0;
+        pthread_mutex_init(&node->quadrant_lock[q], NULL);
+    }
+    node->parent = parent;
+    node->product = product;
+    node->domain = domain;
+    for (int i = 0; i < 7; i++) {
+        pushTask(node, i);
+    }
+    return node;
+}
+
+
+// C quadrant += sign * P, reduced like the other kernels under --mod. The
+// first product into a quadrant is written instead, so C is never zeroed.
+static void addInto(elem_t** Cq, elem_t** P, int k, int sign, int first) {
+#if !ELEM_IS_FLOAT
+    elem_t p = strassen_modulus;
+    if (p) {
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < k; j++) {
+                elem_t c = first ? 0 : Cq[i][j];
+                elem_t s = sign > 0 ? c + P[i][j] : c - P[i][j];
+                Cq[i][j] = s >= p ? s - p : (s < 0 ? s + p : s);
+            }
+        }
+        return;
+    }
+#endif
+    if (first) {
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < k; j++) {
+                Cq[i][j] = sign > 0 ? P[i][j] : -P[i][j];
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < k; i++) {
+        elem_t* c = Cq[i];
+        const elem_t* x = P[i];
+        if (sign > 0) {
+            for (int j = 0; j < k; j++) {
+                c[j] += x[j];
+            }
+        } else {
+            for (int j = 0; j < k; j++) {
+                c[j] -= x[j];
+            }
+        }
+    }
+}
+
+
+// Add finished product i of node into its C quadrants; completing the last
+// product completes the node, which is in turn a product of its parent
+static void accumulate(DagNode* node, int i, elem_t** P) {
+    elem_t** retired = NULL;   // C of a finished child, once added upwards
+    for (;;) {
+        int k = node->n / 2;
+        for (int q = 0; q < 4; q++) {
+            if (strassenProductSigns[i][q] != 0) {
+                elem_t** Cq = quadrantView(node->C, k, q);
+                pthread_mutex_lock(&node->quadrant_lock[q]);
+                addInto(Cq, P, k, strassenProductSigns[i][q], !node->written[q]);
+                node->written[q] = 1;
+                pthread_mutex_unlock(&node->quadrant_lock[q]);
+                free(Cq);
+            }
+        }
+        if (retired) {
+            freeMatrix(retired, k);
+        }
+
+        pthread_mutex_lock(&pool.lock);
+        int last = --node->remaining == 0;
+        if (last && node->parent == NULL) {
+            pool.finished = 1;
+            pthread_cond_broadcast(&pool.ready);
+        }
+        pthread_mutex_unlock(&pool.lock);
+        if (!last || node->parent == NULL) {
+            return;
+        }
+
+        // The node's C is its parent's product; pass it up and retire the node
+        DagNode* parent = node->parent;
+        i = node->product;
+        releaseOperand(node->A, node->n, node->owns_a);
+        releaseOperand(node->B, node->n, node->owns_b);
+        for (int q = 0; q < 4; q++) {
+            pthread_mutex_destroy(&node->quadrant_lock[q]);
+        }
+        P = retired = node->C;
+        free(node);
+        node = parent;
+    }
+}
+
+
+// Run on a thread of the given domain; a node it creates has its buffers
+// there, so its products are queued there too
+static void runProduct(DagNode* node, int i, int domain) {
+    int k = node->n / 2;
+    int owns_a, owns_b;
+    elem_t** tempA = formOperand(node->A, strassenLeftTransform, i, k, &owns_a);
+    elem_t** tempB = formOperand(node->B, strassenRightTransform, i, k, &owns_b);
+
+    if (k <= pool.cutoff || k == 1) {
+        elem_t** P = standardMultiply(tempA, tempB, k);
+        releaseOperand(tempA, k, owns_a);
+        releaseOperand(tempB, k, owns_b);
+        accumulate(node, i, P);
+        freeMatrix(P, k);
+    } else {
+        // Views into node's operands stay valid: node outlives its products
+        newNode(tempA, owns_a, tempB, owns_b, k, node, i, domain);
+    }
+}
+
+
+// Next task for a thread of domain, from its own queue while it has any and
+// otherwise stolen from another. Called with the pool locked.
+static DagTask takeTask(int domain) {
+    DagQueue* queue = &pool.queues[domain];
+    for (int d = 1; queue->count == 0 && d < pool.num_domains; d++) {
+        queue = &pool.queues[(domain + d) % pool.num_domains];
+    }
+    pool.pending--;
+    return queue->tasks[--queue->count];
+}
+
+
+// Run tasks until the root is finished. The calling thread keeps sending
+// heartbeats while it waits, since it alone may use MPI.
+static void serveTasks(int domain, int main_thread) {
+    pthread_mutex_lock(&pool.lock);
+    while (!pool.finished) {
+        if (pool.pending == 0) {
+            if (main_thread) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_nsec += 1000000;
+                if (deadline.tv_nsec >= 1000000000L) {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000L;
+                }
+                pthread_cond_timedwait(&pool.ready, &pool.lock, &deadline);
+                pthread_mutex_unlock(&pool.lock);
+                heartbeatPoll();
+                pthread_mutex_lock(&pool.lock);
+            } else {
+                pthread_cond_wait(&pool.ready, &pool.lock);
+            }
+            continue;
+        }
+        DagTask task = takeTask(domain);
+        pthread_mutex_unlock(&pool.lock);
+        runProduct(task.node, task.product, domain);
+        if (main_thread) {
+            heartbeatPoll();
+        }
+        pthread_mutex_lock(&pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
+
+
+static void* workerThread(void* arg) {
+    int domain = *(int*)arg;
+    if (pool.num_domains > 1) {
+        numaBindThread(domain);
+    }
+    serveTasks(domain, 0);
+    return NULL;
+}
+
+
+elem_t** dagMultiply(elem_t** A, elem_t** B, int n, int cutoff) {
+    if (n <= cutoff || n == 1) {
+        return standardMultiply(A, B, n);
+    }
+
+    // The calling thread stays unpinned for MPI; helpers are spread over the
+    // domains starting with the next one
+    pool.num_domains = alloc_numa ? numaNodeCount() : 1;
+    pool.queues = (DagQueue*)calloc(pool.num_domains, sizeof(DagQueue));
+    pool.pending = 0;
+    pool.finished = 0;
+    pool.cutoff = cutoff;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.ready, NULL);
+
+    // The root borrows A and B; views of all rows are released like any other
+    elem_t** rowsA = quadrantView(A, n, 0);
+    elem_t** rowsB = quadrantView(B, n, 0);
+    int main_domain = numaCurrentNode() % pool.num_domains;
+    DagNode* root = newNode(rowsA, 0, rowsB, 0, n, NULL, 0, main_domain);
+
+    int helpers = dag_threads - 1;
+    pthread_t* threads = (pthread_t*)malloc((helpers > 0 ? helpers : 1) * sizeof(pthread_t));
+    int* domains = (int*)malloc((helpers > 0 ? helpers : 1) * sizeof(int));
+    for (int t = 0; t < helpers; t++) {
+        domains[t] = (main_domain + t + 1) % pool.num_domains;
+        pthread_create(&threads[t], NULL, workerThread, &domains[t]);
+    }
+    serveTasks(main_domain, 1);
+    for (int t = 0; t < helpers; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+    free(domains);
+
+    elem_t** C = root->C;
+    free(root->A);
+    free(root->B);
+    for (int q = 0; q < 4; q++) {
+        pthread_mutex_destroy(&root->quadrant_lock[q]);
+    }
+    free(root);
+    for (int d = 0; d < pool.num_domains; d++) {
+        free(pool.queues[d].tasks);
+    }
+    free(pool.queues);
+    pool.queues = NULL;
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.ready);
+    return C;
+}
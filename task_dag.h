@@ -0,0 +1,32 @@
+#ifndef TASK_DAG_H
+#define TASK_DAG_H
+
+#include "matrix_utils.h"
+
+// Strassen as a task graph instead of a depth-first call tree. Every product
+// P_i of every node is a task: it forms its two operand sums and either
+// multiplies them at the cutoff or becomes a node of seven tasks itself. A
+// finished product is added straight into the C quadrants it belongs to,
+// under a per-quadrant lock, so a node's combination proceeds while its other
+// products are still running and no level waits for all seven before adding.
+// Ready tasks from every branch and level share one LIFO queue, served by a
+// pool of threads, so independent work interleaves and idle threads pick up
+// whatever is ready. The LIFO order keeps the traversal close to depth-first
+// and bounds the memory held by operand sums. With --numa there is one queue
+// per NUMA node, served by threads pinned to it: a task runs where the node
+// that spawned it allocated its buffers, and a thread whose queue is empty
+// steals from the others.
+//
+// The products land in C in completion order. Integer results are exact
+// regardless; floating-point results may differ in the last bits from run
+// to run, within the same error bound (accuracy.h).
+
+extern int dag_threads;   // Set by --threads; 1 keeps the recursive engine
+
+void setDagThreads(int threads);
+
+// C = A * B with leaves of at most cutoff, on dag_threads threads. The calling
+// thread works too and is the only one that touches MPI (heartbeats).
+elem_t** dagMultiply(elem_t** A, elem_t** B, int n, int cutoff);
+
+#endif // TASK_DAG_H
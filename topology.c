@@ -0,0 +1,132 @@
+#include "topology.h"
+#include <stdlib.h>
+
+static int tree_size = 0;
+static int* slot_rank = NULL;   // Slot -> world rank
+static int* rank_slot = NULL;   // World rank -> slot
+static int* node_of = NULL;     // World rank -> node id
+static int* socket_of = NULL;   // World rank -> socket id (node id if unknown)
+
+
+// World rank of the lowest rank sharing a communicator of the given split type
+static int localityId(int split_type, int rank) {
+    MPI_Comm comm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, split_type, rank, MPI_INFO_NULL, &comm);
+    int leader = rank;
+    MPI_Allreduce(&rank, &leader, 1, MPI_INT, MPI_MIN, comm);
+    MPI_Comm_free(&comm);
+    return leader;
+}
+
+
+// 0 = same socket, 1 = same node, 2 = different nodes
+static int distance(int a, int b) {
+    if (node_of[a] != node_of[b]) {
+        return 2;
+    }
+    return socket_of[a] == socket_of[b] ? 0 : 1;
+}
+
+
+static void buildTopologyMapping(int num_procs) {
+    int* used = (int*)calloc(num_procs, sizeof(int));
+    int* free_on_node = (int*)calloc(num_procs, sizeof(int));
+    for (int r = 0; r < num_procs; r++) {
+        free_on_node[node_of[r]]++;
+    }
+
+    slot_rank[0] = 0;
+    used[0] = 1;
+    free_on_node[node_of[0]]--;
+
+    // Slots in breadth-first order are simply 1, 2, 3, ...
+    for (int slot = 1; slot < num_procs; slot++) {
+        int parent = slot_rank[(slot - 1) / 7];
+        int best = -1;
+        for (int r = 0; r < num_procs; r++) {
+            if (used[r]) {
+                continue;
+            }
+            if (best < 0 || distance(parent, r) < distance(parent, best) ||
+                (distance(parent, r) == 2 && distance(parent, best) == 2 &&
+                 free_on_node[node_of[r]] > free_on_node[node_of[best]])) {
+                best = r;
+            }
+        }
+        slot_rank[slot] = best;
+        used[best] = 1;
+        free_on_node[node_of[best]]--;
+    }
+
+    free(used);
+    free(free_on_node);
+}
+
+
+void topologyInit(int mapping, int ranks_per_node, int rank, int num_procs) {
+    tree_size = num_procs;
+    slot_rank = (int*)malloc(num_procs * sizeof(int));
+    rank_slot = (int*)malloc(num_procs * sizeof(int));
+    node_of = (int*)malloc(num_procs * sizeof(int));
+    socket_of = (int*)malloc(num_procs * sizeof(int));
+
+    int ids[2];
+    if (ranks_per_node > 0) {
+        ids[0] = rank - rank % ranks_per_node;
+        ids[1] = ids[0];
+    } else {
+        ids[0] = localityId(MPI_COMM_TYPE_SHARED, rank);
+#ifdef OMPI_COMM_TYPE_SOCKET
+        ids[1] = localityId(OMPI_COMM_TYPE_SOCKET, rank);
+#else
+        ids[1] = ids[0];
+#endif
+    }
+    int* all_ids = (int*)malloc(2 * num_procs * sizeof(int));
+    MPI_Allgather(ids, 2, MPI_INT, all_ids, 2, MPI_INT, MPI_COMM_WORLD);
+    for (int r = 0; r < num_procs; r++) {
+        node_of[r] = all_ids[2 * r];
+        socket_of[r] = all_ids[2 * r + 1];
+    }
+    free(all_ids);
+
+    // Every rank computes the same mapping from the same gathered data
+    if (mapping == MAPPING_TOPOLOGY) {
+        buildTopologyMapping(num_procs);
+    } else {
+        for (int s = 0; s < num_procs; s++) {
+            slot_rank[s] = s;
+        }
+    }
+    for (int s = 0; s < num_procs; s++) {
+        rank_slot[slot_rank[s]] = s;
+    }
+}
+
+
+int childRank(int rank, int i) {
+    int child_slot = rank_slot[rank] * 7 + i + 1;
+    return child_slot < tree_size ? slot_rank[child_slot] : -1;
+}
+
+
+int treeDepth(int rank) {
+    int slot = rank_slot[rank];
+    int depth = 0;
+    while (slot > 0) {
+        slot = (slot - 1) / 7;
+        depth++;
+    }
+    return depth;
+}
+
+
+int crossNodeEdges(void) {
+    int edges = 0;
+    for (int s = 1; s < tree_size; s++) {
+        if (node_of[slot_rank[s]] != node_of[slot_rank[(s - 1) / 7]]) {
+            edges++;
+        }
+    }
+    return edges;
+}
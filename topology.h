@@ -0,0 +1,31 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <mpi.h>
+
+// Placement of the 7-ary process tree on the machine. The tree is defined on
+// slots: slot s has children 7s+1 .. 7s+7, and slot 0 is always rank 0. With
+// the linear mapping slot s is rank s. The topology mapping fills slots in
+// breadth-first order, giving each child the free rank closest to its parent
+// (same socket, then same node, then the node with most free ranks). The top
+// levels, which move the largest operands, therefore stay inside a node and
+// only the smaller subproblems cross the network.
+#define MAPPING_LINEAR 0
+#define MAPPING_TOPOLOGY 1
+
+// Build the mapping. Collective over MPI_COMM_WORLD. ranks_per_node > 0
+// pretends consecutive blocks of that many ranks are separate nodes, to try
+// the placement on a single machine. Must run before any distributed
+// multiplication.
+void topologyInit(int mapping, int ranks_per_node, int rank, int num_procs);
+
+// World rank of child i (0-6) of rank in the tree, or -1 if there is none
+int childRank(int rank, int i);
+
+// Depth of rank in the tree (rank 0 is at depth 0)
+int treeDepth(int rank);
+
+// Tree edges whose parent and child are on different nodes
+int crossNodeEdges(void);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,205 @@
+#include "trace.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef enum {
+    TRACE_PHASE,
+    TRACE_TASK,
+    TRACE_SEND,
+    TRACE_RECV
+} TraceKind;
+
+typedef struct {
+    double start;      // Seconds since the common origin
+    double end;
+    long long bytes;
+    long long flow;    // Message sequence number between the two ranks
+    int kind;
+    int phase;
+    int level;
+    int product;
+    int n;
+    int peer;
+} TraceEvent;
+
+int trace_enabled = 0;
+
+static TraceEvent* events = NULL;
+static int num_events = 0;
+static int capacity = 0;
+static double origin = 0.0;
+
+// Per-peer message counters, used to pair each send with its receive
+static long long* sent_to = NULL;
+static long long* received_from = NULL;
+
+
+void traceEnable(int num_procs) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    origin = MPI_Wtime();
+    sent_to = (long long*)calloc(num_procs, sizeof(long long));
+    received_from = (long long*)calloc(num_procs, sizeof(long long));
+    trace_enabled = 1;
+}
+
+
+static TraceEvent* newEvent(int kind, double start) {
+    if (num_events == capacity) {
+        capacity = capacity ? capacity * 2 : 1024;
+        events = (TraceEvent*)realloc(events, capacity * sizeof(TraceEvent));
+    }
+    TraceEvent* e = &events[num_events++];
+    e->kind = kind;
+    e->start = start - origin;
+    e->end = MPI_Wtime() - origin;
+    e->bytes = 0;
+    e->flow = -1;
+    e->phase = -1;
+    e->level = -1;
+    e->product = -1;
+    e->n = 0;
+    e->peer = -1;
+    return e;
+}
+
+
+void traceTask(int level, int product, int n, double start) {
+    if (!trace_enabled) {
+        return;
+    }
+    TraceEvent* e = newEvent(TRACE_TASK, start);
+    e->level = level;
+    e->product = product;
+    e->n = n;
+}
+
+
+void traceSend(int level, int product, int n, int peer, long long bytes, double start) {
+    if (!trace_enabled) {
+        return;
+    }
+    TraceEvent* e = newEvent(TRACE_SEND, start);
+    e->level = level;
+    e->product = product;
+    e->n = n;
+    e->peer = peer;
+    e->bytes = bytes;
+    e->flow = sent_to[peer]++;
+}
+
+
+void traceRecv(int level, int product, int n, int peer, long long bytes, double start) {
+    if (!trace_enabled) {
+        return;
+    }
+    TraceEvent* e = newEvent(TRACE_RECV, start);
+    e->level = level;
+    e->product = product;
+    e->n = n;
+    e->peer = peer;
+    e->bytes = bytes;
+    e->flow = received_from[peer]++;
+}
+
+
+void tracePhase(int phase, int level, double start, long long bytes) {
+    TraceEvent* e = newEvent(TRACE_PHASE, start);
+    e->phase = phase;
+    e->level = level;
+    e->bytes = bytes;
+}
+
+
+static void writeEvent(FILE* out, const TraceEvent* e, int rank, int num_procs) {
+    double ts = e->start * 1e6;
+    double dur = (e->end - e->start) * 1e6;
+
+    switch (e->kind) {
+        case TRACE_PHASE:
+            fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": %d, \"tid\": 1, "
+                         "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"level\": %d, \"bytes\": %lld}}",
+                    profilePhaseName(e->phase), rank, ts, dur, e->level, e->bytes);
+            break;
+        case TRACE_TASK:
+            fprintf(out, ",\n{\"name\": \"P%d\", \"cat\": \"task\", \"ph\": \"X\", \"pid\": %d, \"tid\": 0, "
+                         "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"level\": %d, \"product\": %d, \"n\": %d}}",
+                    e->product + 1, rank, ts, dur, e->level, e->product + 1, e->n);
+            break;
+        case TRACE_SEND:
+        case TRACE_RECV: {
+            int sending = e->kind == TRACE_SEND;
+            int src = sending ? rank : e->peer;
+            int dst = sending ? e->peer : rank;
+            long long id = ((long long)src * num_procs + dst) * 1000000LL + e->flow;
+            fprintf(out, ",\n{\"name\": \"%s %d\", \"cat\": \"msg\", \"ph\": \"X\", \"pid\": %d, \"tid\": 2, "
+                         "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"level\": %d, \"product\": %d, \"n\": %d, "
+                         "\"peer\": %d, \"bytes\": %lld}}",
+                    sending ? "send to" : "recv from", e->peer, rank, ts, dur,
+                    e->level, e->product + 1, e->n, e->peer, e->bytes);
+            // Flow arrow from the start of the send to the end of the receive
+            fprintf(out, ",\n{\"name\": \"message\", \"cat\": \"msg\", \"ph\": \"%s\", %s\"id\": %lld, "
+                         "\"pid\": %d, \"tid\": 2, \"ts\": %.3f}",
+                    sending ? "s" : "f", sending ? "" : "\"bp\": \"e\", ", id, rank,
+                    sending ? ts : ts + dur);
+            break;
+        }
+    }
+}
+
+
+void traceWrite(const char* path, int rank, int num_procs) {
+    int bytes = num_events * (int)sizeof(TraceEvent);
+    int* counts = NULL;
+    int* displs = NULL;
+    TraceEvent* all = NULL;
+
+    if (rank == 0) {
+        counts = (int*)malloc(num_procs * sizeof(int));
+        displs = (int*)malloc(num_procs * sizeof(int));
+    }
+    MPI_Gather(&bytes, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        int total = 0;
+        for (int r = 0; r < num_procs; r++) {
+            displs[r] = total;
+            total += counts[r];
+        }
+        all = (TraceEvent*)malloc(total > 0 ? total : 1);
+    }
+    MPI_Gatherv(events, bytes, MPI_BYTE, all, counts, displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        FILE* out = fopen(path, "w");
+        if (!out) {
+            printf("WARNING: Cannot write trace to %s\n", path);
+        } else {
+            fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+            for (int r = 0; r < num_procs; r++) {
+                fprintf(out, "%s{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+                             "\"args\": {\"name\": \"rank %d\"}}", r ? ",\n" : "", r, r);
+                const TraceEvent* rank_events = (const TraceEvent*)((const char*)all + displs[r]);
+                int count = counts[r] / (int)sizeof(TraceEvent);
+                for (int i = 0; i < count; i++) {
+                    writeEvent(out, &rank_events[i], r, num_procs);
+                }
+            }
+            fprintf(out, "\n]}\n");
+            fclose(out);
+            printf("Trace written to %s\n", path);
+        }
+    }
+
+    free(counts);
+    free(displs);
+    free(all);
+    free(events);
+    free(sent_to);
+    free(received_from);
+    events = NULL;
+    sent_to = NULL;
+    received_from = NULL;
+    num_events = capacity = 0;
+    trace_enabled = 0;
+}
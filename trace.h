@@ -0,0 +1,30 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <mpi.h>
+
+extern int trace_enabled;
+
+// Start recording. Must be called by all ranks: it synchronizes them with a
+// barrier so that timestamps share a common origin.
+void traceEnable(int num_procs);
+
+// One timed task: computing Strassen product `product` of size n at `level`
+void traceTask(int level, int product, int n, double start);
+
+// One logical message (operands or a result) exchanged with `peer`
+void traceSend(int level, int product, int n, int peer, long long bytes, double start);
+void traceRecv(int level, int product, int n, int peer, long long bytes, double start);
+
+// Phase slices reported through the profile hooks
+void tracePhase(int phase, int level, double start, long long bytes);
+
+// Gather every rank's events on rank 0 and write a Chrome trace JSON file
+// (open with chrome://tracing or ui.perfetto.dev). Must be called by all ranks.
+void traceWrite(const char* path, int rank, int num_procs);
+
+static inline double traceStart(void) {
+    return trace_enabled ? MPI_Wtime() : 0.0;
+}
+
+#endif // TRACE_H
@@ -0,0 +1,328 @@
+#include "verify.h"
+#include "modular.h"
+#include "accuracy.h"
+#include "strassen_mpi.h"
+#include "strassen_prepared.h"
+#include <math.h>
+
+// Largest acceptable |C - reference| per entry. Integer results must match
+// exactly; floating-point results may differ by the error bounds of both the
+// distributed product and the reference, widened by 4 because power-of-two
+// diagonal scaling can change max|A| * max|B| by up to that factor.
+static double checkTolerance(elem_t** A, elem_t** B, int n, int reference_cutoff) {
+    double max_a = (double)maxAbsElement(A, n);
+    double max_b = (double)maxAbsElement(B, n);
+    return 4.0 * (strassenErrorBound(n, getSizeThreshold(), max_a, max_b) +
+                  strassenErrorBound(n, reference_cutoff, max_a, max_b));
+}
+
+static int entriesMatch(elem_t x, elem_t y, double tolerance) {
+#if ELEM_IS_FLOAT
+    return fabs(x - y) <= tolerance;
+#else
+    (void)tolerance;
+    return x == y;
+#endif
+}
+
+
+// Index of the first entry where X and Y differ by more than tolerance, or -1
+static long long firstMismatch(elem_t** X, elem_t** Y, int n, double tolerance) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if (!entriesMatch(X[i][j], Y[i][j], tolerance)) {
+                return (long long)i * n + j;
+            }
+        }
+    }
+    return -1;
+}
+
+
+double verifyResult(elem_t** A, elem_t** B, elem_t** C, int n) {
+    printf("\nVerifying result with Strassen sequential multiplication...\n");
+    double verify_start = MPI_Wtime();
+    elem_t** C_verify = strassenMultiply(A, B, n);
+    double verify_time = MPI_Wtime() - verify_start;
+
+    printf("Strassen sequential multiplication time: %.6f seconds\n", verify_time);
+
+    double tolerance = checkTolerance(A, B, n, SEQUENTIAL_CUTOFF);
+    int correct = 1;
+    for (int i = 0; i < n && correct; i++) {
+        for (int j = 0; j < n && correct; j++) {
+            if (!entriesMatch(C[i][j], C_verify[i][j], tolerance)) {
+                correct = 0;
+                printf("Mismatch at [%d][%d]: Strassen MPI=%" ELEM_FMT ", Strassen Seq=%" ELEM_FMT "\n",
+                        i, j, C[i][j], C_verify[i][j]);
+                break;
+            }
+        }
+    }
+
+    if (correct) {
+        printf("Verification PASSED - Results match!\n");
+    } else {
+        printf("Verification FAILED - Results do not match!\n");
+    }
+
+    freeMatrix(C_verify, n);
+
+    return verify_time;
+}
+
+
+int verifyPrepared(elem_t** A, elem_t** B, elem_t** C, int n) {
+    printf("\nVerifying result and prepared operands against Strassen sequential multiplication...\n");
+    elem_t** reference = strassenMultiply(A, B, n);
+    double tolerance = checkTolerance(A, B, n, SEQUENTIAL_CUTOFF);
+
+    double prepare_start = MPI_Wtime();
+    PreparedOperand* left = prepareOperand(A, n, PREPARED_LEFT);
+    PreparedOperand* right = prepareOperand(B, n, PREPARED_RIGHT);
+    double prepare_time = MPI_Wtime() - prepare_start;
+    double multiply_start = MPI_Wtime();
+    elem_t** C_left = strassenMultiplyPrepared(left, B);
+    elem_t** C_right = strassenMultiplyPrepared(right, A);
+    double multiply_time = MPI_Wtime() - multiply_start;
+    printf("Preparing both operands: %.6f seconds, both prepared multiplies: %.6f seconds\n",
+           prepare_time, multiply_time);
+
+    elem_t** results[3] = { C, C_left, C_right };
+    const char* names[3] = { "Strassen MPI", "Prepared left", "Prepared right" };
+    int correct = 1;
+    for (int r = 0; r < 3; r++) {
+        long long at = firstMismatch(results[r], reference, n, tolerance);
+        if (at >= 0) {
+            int i = (int)(at / n);
+            int j = (int)(at % n);
+            printf("Mismatch at [%d][%d]: %s=%" ELEM_FMT ", Strassen Seq=%" ELEM_FMT "\n",
+                   i, j, names[r], results[r][i][j], reference[i][j]);
+            correct = 0;
+        }
+    }
+
+    if (correct) {
+        printf("Verification PASSED - Results match!\n");
+    } else {
+        printf("Verification FAILED - Results do not match!\n");
+    }
+
+    freeMatrix(C_left, n);
+    freeMatrix(C_right, n);
+    freeMatrix(reference, n);
+    freePreparedOperand(left);
+    freePreparedOperand(right);
+    return correct;
+}
+
+
+// xorshift32, only used to draw the test vectors
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+
+// y = M * x in double precision
+static void multiplyVectorDouble(elem_t** M, const double* x, double* y, int n) {
+    for (int i = 0; i < n; i++) {
+        double sum = 0;
+        const elem_t* row = M[i];
+        for (int j = 0; j < n; j++) {
+            sum += (double)row[j] * x[j];
+        }
+        y[i] = sum;
+    }
+}
+
+
+double residualEstimate(elem_t** A, elem_t** B, elem_t** C, int n, int trials, unsigned int seed) {
+    double* r = (double*)malloc(n * sizeof(double));
+    double* Br = (double*)malloc(n * sizeof(double));
+    double* ABr = (double*)malloc(n * sizeof(double));
+    double* Cr = (double*)malloc(n * sizeof(double));
+    double scale = (double)n * (double)maxAbsElement(A, n) * (double)maxAbsElement(B, n);
+    unsigned int state = seed ? seed : 1;
+    double residual = 0.0;
+
+    for (int t = 0; t < trials; t++) {
+        for (int j = 0; j < n; j++) {
+            r[j] = (nextRandom(&state) & 1) ? 1.0 : -1.0;
+        }
+        multiplyVectorDouble(B, r, Br, n);
+        multiplyVectorDouble(A, Br, ABr, n);
+        multiplyVectorDouble(C, r, Cr, n);
+        for (int i = 0; i < n; i++) {
+            double d = fabs(Cr[i] - ABr[i]);
+            if (d > residual) {
+                residual = d;
+            }
+        }
+    }
+
+    free(r);
+    free(Br);
+    free(ABr);
+    free(Cr);
+    return scale > 0 ? residual / scale : residual;
+}
+
+
+#if ELEM_IS_FLOAT
+int verifyFreivalds(elem_t** A, elem_t** B, elem_t** C, int n, int trials, unsigned int seed) {
+    // Up to 2n u of the residual comes from forming A(Br) and Cr themselves
+    double residual = residualEstimate(A, B, C, n, trials, seed);
+    double limit = 4.0 * (strassenErrorBound(n, getSizeThreshold(), 1.0, 1.0) + 2.0 * n * ELEM_EPSILON);
+    printf("Relative residual: %.3g (limit %.3g)\n", residual, limit);
+    return residual <= limit;
+}
+#else
+// y = M * x modulo 2^w, w being the element width
+static void multiplyVector(elem_t** M, const uelem_t* x, uelem_t* y, int n) {
+    for (int i = 0; i < n; i++) {
+        uelem_t sum = 0;
+        const elem_t* row = M[i];
+        for (int j = 0; j < n; j++) {
+            sum += (uelem_t)row[j] * x[j];
+        }
+        y[i] = sum;
+    }
+}
+
+
+// y = M * x modulo p, for runs in modular mode (entries and x in [0, p))
+static void multiplyVectorMod(elem_t** M, const uelem_t* x, uelem_t* y, int n, unsigned long long p) {
+    for (int i = 0; i < n; i++) {
+        unsigned long long sum = 0;
+        const elem_t* row = M[i];
+        for (int j = 0; j < n; j++) {
+            sum = (sum + (unsigned long long)row[j] * x[j]) % p;
+        }
+        y[i] = (uelem_t)sum;
+    }
+}
+
+
+int verifyFreivalds(elem_t** A, elem_t** B, elem_t** C, int n, int trials, unsigned int seed) {
+    uelem_t* r = (uelem_t*)malloc(n * sizeof(uelem_t));
+    uelem_t* Br = (uelem_t*)malloc(n * sizeof(uelem_t));
+    uelem_t* ABr = (uelem_t*)malloc(n * sizeof(uelem_t));
+    uelem_t* Cr = (uelem_t*)malloc(n * sizeof(uelem_t));
+    unsigned int state = seed ? seed : 1;
+    unsigned long long p = (unsigned long long)strassen_modulus;
+    int passed = 1;
+
+    for (int t = 0; t < trials && passed; t++) {
+        for (int j = 0; j < n; j++) {
+            r[j] = (uelem_t)(((unsigned long long)nextRandom(&state) << 32) | nextRandom(&state));
+        }
+        if (p) {
+            for (int j = 0; j < n; j++) {
+                r[j] %= p;
+            }
+            multiplyVectorMod(B, r, Br, n, p);
+            multiplyVectorMod(A, Br, ABr, n, p);
+            multiplyVectorMod(C, r, Cr, n, p);
+        } else {
+            multiplyVector(B, r, Br, n);
+            multiplyVector(A, Br, ABr, n);
+            multiplyVector(C, r, Cr, n);
+        }
+        for (int i = 0; i < n; i++) {
+            if (ABr[i] != Cr[i]) {
+                printf("Freivalds check failed in trial %d: row %d of C is wrong\n", t + 1, i);
+                passed = 0;
+                break;
+            }
+        }
+    }
+
+    free(r);
+    free(Br);
+    free(ABr);
+    free(Cr);
+    return passed;
+}
+#endif
+
+
+long long verifyExactDistributed(elem_t** A, elem_t** B, elem_t** C, int n, int rank, int num_procs) {
+    // Contiguous block of rows per rank
+    int* counts = (int*)malloc(num_procs * sizeof(int));
+    int* displs = (int*)malloc(num_procs * sizeof(int));
+    int offset = 0;
+    for (int r = 0; r < num_procs; r++) {
+        int rows = n / num_procs + (r < n % num_procs ? 1 : 0);
+        counts[r] = rows * n;
+        displs[r] = offset;
+        offset += counts[r];
+    }
+    int my_rows = counts[rank] / n;
+
+    elem_t* flatB = rank == 0 ? flattenMatrix(B, n) : (elem_t*)malloc((size_t)n * n * sizeof(elem_t));
+    MPI_Bcast(flatB, n * n, MPI_ELEM, 0, MPI_COMM_WORLD);
+
+    elem_t* flatA = NULL;
+    elem_t* flatC = NULL;
+    if (rank == 0) {
+        flatA = flattenMatrix(A, n);
+        flatC = flattenMatrix(C, n);
+    }
+    elem_t* rowsA = (elem_t*)malloc(((size_t)counts[rank] + 1) * sizeof(elem_t));
+    elem_t* rowsC = (elem_t*)malloc(((size_t)counts[rank] + 1) * sizeof(elem_t));
+    MPI_Scatterv(flatA, counts, displs, MPI_ELEM, rowsA, counts[rank], MPI_ELEM, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(flatC, counts, displs, MPI_ELEM, rowsC, counts[rank], MPI_ELEM, 0, MPI_COMM_WORLD);
+    free(flatA);
+    free(flatC);
+
+    double tolerance = rank == 0 ? checkTolerance(A, B, n, n) : 0.0;
+    MPI_Bcast(&tolerance, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    // Recompute the local rows with the classical i-k-j loop
+    unsigned long long p = (unsigned long long)strassen_modulus;
+    elem_t* row = (elem_t*)malloc(n * sizeof(elem_t));
+    long long mismatches = 0;
+    for (int i = 0; i < my_rows; i++) {
+        for (int j = 0; j < n; j++) {
+            row[j] = 0;
+        }
+        for (int k = 0; k < n; k++) {
+            elem_t a = rowsA[(size_t)i * n + k];
+            const elem_t* Brow = flatB + (size_t)k * n;
+            if (p) {
+                for (int j = 0; j < n; j++) {
+                    row[j] = (elem_t)(((unsigned long long)row[j] + (unsigned long long)a * (unsigned long long)Brow[j]) % p);
+                }
+            } else {
+                for (int j = 0; j < n; j++) {
+                    row[j] += a * Brow[j];
+                }
+            }
+        }
+        for (int j = 0; j < n; j++) {
+            if (!entriesMatch(row[j], rowsC[(size_t)i * n + j], tolerance)) {
+                if (mismatches == 0) {
+                    printf("Mismatch at [%d][%d] (rank %d): C=%" ELEM_FMT ", expected=%" ELEM_FMT "\n",
+                           displs[rank] / n + i, j, rank, rowsC[(size_t)i * n + j], row[j]);
+                }
+                mismatches++;
+            }
+        }
+    }
+
+    long long total = 0;
+    MPI_Reduce(&mismatches, &total, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    free(row);
+    free(rowsA);
+    free(rowsC);
+    free(flatB);
+    free(counts);
+    free(displs);
+    return total;
+}
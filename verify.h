@@ -0,0 +1,44 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "matrix_utils.h"
+
+// How the product is checked after a run
+typedef enum {
+    VERIFY_NONE,
+    VERIFY_FREIVALDS,    // Randomized O(n^2) check on rank 0 (default)
+    VERIFY_EXACT,        // Every entry recomputed, rows spread over all ranks
+    VERIFY_SEQUENTIAL,   // Sequential Strassen on rank 0, also timed
+    VERIFY_PREPARED      // Also prepared operands (strassen_prepared.h) on rank 0
+} VerifyMode;
+
+#define FREIVALDS_TRIALS 8
+
+// Recompute C with sequential Strassen on rank 0; returns its wall time
+double verifyResult(elem_t** A, elem_t** B, elem_t** C, int n);
+
+// Check C and the products of prepared operands on rank 0: A prepared as
+// the left operand times B, and A times B prepared as the right operand,
+// against sequential Strassen. Returns 1 if all three match.
+int verifyPrepared(elem_t** A, elem_t** B, elem_t** C, int n);
+
+// Freivalds' check: compare C*r with A*(B*r) for `trials` random vectors r.
+// Arithmetic is modulo 2^w for w-bit elements, matching integer wraparound,
+// so the check stays exact even if the product overflowed, or modulo p when a
+// modulus is set. A wrong C passes each trial with probability at most 1/2.
+// Floating-point builds instead accept a residual within the error bound of
+// the distributed product (see accuracy.h). Returns 1 if all trials pass.
+int verifyFreivalds(elem_t** A, elem_t** B, elem_t** C, int n, int trials, unsigned int seed);
+
+// max |C r - A (B r)| over random sign vectors r, relative to n * max|A| * max|B|.
+// Comparable with strassenErrorCoefficient() * u; computed in double precision.
+double residualEstimate(elem_t** A, elem_t** B, elem_t** C, int n, int trials, unsigned int seed);
+
+// Exact check of every entry. Rank 0 broadcasts B and scatters the rows of A
+// and C; each rank recomputes its rows (to within rounding error for
+// floating-point elements). Must be called by all ranks (A, B, C are only
+// read on rank 0) and follows the modulus like the kernels. Returns the number
+// of mismatching entries on rank 0.
+long long verifyExactDistributed(elem_t** A, elem_t** B, elem_t** C, int n, int rank, int num_procs);
+
+#endif // VERIFY_H
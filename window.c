@@ -0,0 +1,173 @@
+#include "window.h"
+#include "topology.h"
+
+int transport = TRANSPORT_MSG;
+
+static MPI_Comm node_comm = MPI_COMM_NULL;
+static MPI_Win window = MPI_WIN_NULL;
+static int attached_n = 0;          // Problem size the window was sized for
+static int segment_n = 0;           // Largest parent size this rank's segment holds
+static elem_t* local_segment = NULL;
+static int* node_rank_of = NULL;    // World rank -> rank in node_comm, or -1 (shm)
+static elem_t** segments = NULL;    // Base of every node-local rank's segment (shm)
+
+
+static size_t segmentElements(int n) {
+    size_t k = (size_t)n / 2;
+    return 2 * (size_t)n * n + 7 * k * k;
+}
+
+static MPI_Aint operandOffset(int n, int which) {
+    return (MPI_Aint)which * n * n;
+}
+
+static MPI_Aint productOffset(int n, int product_index) {
+    MPI_Aint k = n / 2;
+    return 2 * (MPI_Aint)n * n + product_index * k * k;
+}
+
+
+static void createNodeComm(int rank, int num_procs) {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+
+    // Translate every world rank into node_comm, once
+    MPI_Group world_group, node_group;
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Comm_group(node_comm, &node_group);
+    int* world_ranks = (int*)malloc(num_procs * sizeof(int));
+    node_rank_of = (int*)malloc(num_procs * sizeof(int));
+    for (int r = 0; r < num_procs; r++) {
+        world_ranks[r] = r;
+    }
+    MPI_Group_translate_ranks(world_group, num_procs, world_ranks, node_group, node_rank_of);
+    for (int r = 0; r < num_procs; r++) {
+        if (node_rank_of[r] == MPI_UNDEFINED) {
+            node_rank_of[r] = -1;
+        }
+    }
+    free(world_ranks);
+    MPI_Group_free(&world_group);
+    MPI_Group_free(&node_group);
+}
+
+
+void windowAttach(int n, int rank, int num_procs) {
+    if (window != MPI_WIN_NULL && n <= attached_n) {
+        return;
+    }
+    windowDetach();
+
+    // Only ranks that have children need a segment. A rank at depth d first
+    // distributes products of size N / 2^d, the largest it ever hands out.
+    int depth = treeDepth(rank);
+    segment_n = childRank(rank, 0) >= 0 && depth < 31 ? n >> depth : 0;
+    MPI_Aint bytes = (MPI_Aint)(segment_n ? segmentElements(segment_n) : 0) * sizeof(elem_t);
+
+    if (transport == TRANSPORT_SHM) {
+        if (node_comm == MPI_COMM_NULL) {
+            createNodeComm(rank, num_procs);
+        }
+        MPI_Info info;
+        MPI_Info_create(&info);
+        MPI_Info_set(info, "alloc_shared_noncontig", "true");
+        MPI_Win_allocate_shared(bytes, sizeof(elem_t), info, node_comm, &local_segment, &window);
+        MPI_Info_free(&info);
+
+        int node_size;
+        MPI_Comm_size(node_comm, &node_size);
+        segments = (elem_t**)malloc(node_size * sizeof(elem_t*));
+        for (int r = 0; r < node_size; r++) {
+            MPI_Aint size;
+            int disp_unit;
+            MPI_Win_shared_query(window, r, &size, &disp_unit, &segments[r]);
+        }
+    } else {
+        MPI_Win_allocate(bytes, sizeof(elem_t), MPI_INFO_NULL, MPI_COMM_WORLD, &local_segment, &window);
+    }
+
+    // Passive target for the window's lifetime; ordering comes from the
+    // header and completion messages plus windowSync()
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+    attached_n = n;
+}
+
+
+void windowDetach(void) {
+    if (window == MPI_WIN_NULL) {
+        return;
+    }
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+    free(segments);
+    segments = NULL;
+    local_segment = NULL;
+    attached_n = 0;
+    segment_n = 0;
+}
+
+
+int windowCanShare(int child, int n) {
+    if (window == MPI_WIN_NULL || n > segment_n) {
+        return 0;
+    }
+    return transport == TRANSPORT_RMA || node_rank_of[child] >= 0;
+}
+
+
+elem_t* windowOperand(int n, int which) {
+    return local_segment + operandOffset(n, which);
+}
+
+
+elem_t* windowProduct(int n, int product_index) {
+    return local_segment + productOffset(n, product_index);
+}
+
+
+void windowReadOperands(int parent, int n, elem_t*** A, elem_t*** B) {
+    if (transport == TRANSPORT_SHM) {
+        elem_t* base = segments[node_rank_of[parent]];
+        *A = wrapFlatMatrix(base + operandOffset(n, 0), n);
+        *B = wrapFlatMatrix(base + operandOffset(n, 1), n);
+        return;
+    }
+
+    // Both gets are in flight together; one flush completes them
+    elem_t* flatA = (elem_t*)malloc((size_t)n * n * sizeof(elem_t));
+    elem_t* flatB = (elem_t*)malloc((size_t)n * n * sizeof(elem_t));
+    MPI_Get(flatA, n * n, MPI_ELEM, parent, operandOffset(n, 0), n * n, MPI_ELEM, window);
+    MPI_Get(flatB, n * n, MPI_ELEM, parent, operandOffset(n, 1), n * n, MPI_ELEM, window);
+    MPI_Win_flush(parent, window);
+    *A = wrapFlatMatrix(flatA, n);
+    *B = wrapFlatMatrix(flatB, n);
+}
+
+
+void windowReleaseOperands(elem_t** A, elem_t** B, int n) {
+    (void)n;
+    if (transport == TRANSPORT_RMA) {
+        // The views own the fetched copies
+        free(A[0]);
+        free(B[0]);
+    }
+    free(A);
+    free(B);
+}
+
+
+void windowWriteProduct(int parent, int n, int product_index, elem_t** result) {
+    int k = n / 2;
+    if (transport == TRANSPORT_SHM) {
+        flattenMatrixInto(result, segments[node_rank_of[parent]] + productOffset(n, product_index), k);
+        return;
+    }
+    elem_t* flat = flattenMatrix(result, k);
+    MPI_Put(flat, k * k, MPI_ELEM, parent, productOffset(n, product_index), k * k, MPI_ELEM, window);
+    MPI_Win_flush(parent, window);
+    free(flat);
+}
+
+
+void windowSync(void) {
+    MPI_Win_sync(window);
+}
@@ -0,0 +1,52 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include "matrix_utils.h"
+
+// Transports for a parent's operands and its children's products
+#define TRANSPORT_MSG 0   // MPI_Send/MPI_Recv of every payload (comm.h)
+#define TRANSPORT_SHM 1   // MPI-3 shared memory window among the ranks of a node
+#define TRANSPORT_RMA 2   // One-sided MPI_Get/MPI_Put on a window over all ranks
+
+// With a window transport every rank that can act as a parent owns a segment
+// laid out as [A | B | P1 .. P7]. The parent flattens its operands into A and
+// B once and sends each child only the work header. The child fetches its
+// operands from the parent's segment and deposits P_i in the parent's slot,
+// then sends an empty completion message:
+//   shm: node-local children split their quadrants straight out of the
+//        segment and store P_i with plain writes; children on other nodes
+//        keep the message path.
+//   rma: any child MPI_Gets A and B and MPI_Puts P_i. The parent never waits
+//        in a matching receive for the operands, and the child is free to
+//        fetch them whenever it is ready.
+
+extern int transport;   // Set by --transport; identical on all ranks
+
+// Create or grow the window for products of size n. Collective over
+// MPI_COMM_WORLD; a window that is already large enough is reused.
+void windowAttach(int n, int rank, int num_procs);
+
+// Release the window. Collective; does nothing if none is attached.
+void windowDetach(void);
+
+// Whether this rank can hand operands of size n to world rank child through
+// its segment
+int windowCanShare(int child, int n);
+
+// This rank's own segment, as a parent of size n
+elem_t* windowOperand(int n, int which);      // 0 = A, 1 = B
+elem_t* windowProduct(int n, int product_index);
+
+// Child side: the operands of parent's size-n assignment as matrices, and
+// their release
+void windowReadOperands(int parent, int n, elem_t*** A, elem_t*** B);
+void windowReleaseOperands(elem_t** A, elem_t** B, int n);
+
+// Child side: deposit the k x k product in the parent's slot product_index
+void windowWriteProduct(int parent, int n, int product_index, elem_t** result);
+
+// Make this rank's stores visible to, and see the stores of, the other ranks.
+// Call before signalling and after being signalled.
+void windowSync(void);
+
+#endif // WINDOW_H